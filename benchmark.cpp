@@ -0,0 +1,366 @@
+// Benchmarks of PriorityQueue, printed as a JSON array of measurements.
+//
+//   g++ -std=c++20 -O2 benchmark.cpp -o benchmark
+//   ./benchmark [max_size] > bench_output.txt
+//
+// Sizes go from 10 up to max_size (default 10^5, up to 10^7) in powers of
+// ten; each size is run for int, std::string and std::vector<int> values
+// drawn from uniform, skewed and duplicate-heavy distributions. Keys are
+// ints. Times are wall clock nanoseconds per operation; operations on
+// small queues are repeated until they add up to a measurable time. The
+// queues an operation works on are built before the clock starts and
+// destroyed after it stops, so a record times its operation only.
+//
+// For sizes up to 256 the same int workloads are also run on
+// StaticPriorityQueue and on PriorityQueue side by side; the "queue" field
+// tells the two apart. It builds as C++14 too, but StaticPriorityQueue then
+// compares with an O(n^2) insertion sort.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "priorityqueue.hh"
+#include "staticpriorityqueue.hh"
+
+namespace {
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+// keeps the optimizer from dropping the measured work
+volatile size_t sink;
+
+// makes the compiler assume *p is read and written here, so that work on it
+// can be neither dropped nor hoisted out of a loop
+inline void escape(const void* p) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(p) : "memory");
+#else
+    sink = sink + reinterpret_cast<uintptr_t>(p);
+#endif
+}
+
+const size_t MIN_WORK = 200000;
+
+std::vector<uint64_t> numbers(const std::string& distribution, size_t n,
+                              std::mt19937_64& random) {
+    std::vector<uint64_t> result(n);
+    if (distribution == "uniform") {
+        std::uniform_int_distribution<uint64_t> d(0, 1ULL << 40);
+        for (auto& x : result)
+            x = d(random);
+    } else if (distribution == "skewed") {
+        // most values crowd near zero, with a long tail
+        std::exponential_distribution<double> d(1.0);
+        for (auto& x : result)
+            x = static_cast<uint64_t>(std::pow(d(random), 4) * 1000.0);
+    } else {
+        std::uniform_int_distribution<uint64_t> d(0, 15);
+        for (auto& x : result)
+            x = d(random);
+    }
+    return result;
+}
+
+template<typename V>
+V makeValue(uint64_t x);
+
+template<>
+int makeValue<int>(uint64_t x) {
+    return static_cast<int>(x & 0x7fffffff);
+}
+
+// fixed-width decimal, so that comparing strings compares the numbers
+template<>
+std::string makeValue<std::string>(uint64_t x) {
+    std::string digits = std::to_string(x);
+    return std::string(40 - digits.size(), '0') + digits;
+}
+
+template<>
+std::vector<int> makeValue<std::vector<int> >(uint64_t x) {
+    std::vector<int> result(16, 0);
+    result[0] = static_cast<int>(x >> 31);
+    result[1] = static_cast<int>(x & 0x7fffffff);
+    return result;
+}
+
+struct measurement {
+    std::string operation;
+    size_t size;
+    size_t operations;
+    double nanoseconds;
+};
+
+template<typename F>
+measurement measure(const std::string& operation, size_t size,
+                    size_t operationsPerRun, F run) {
+    size_t repeats = std::max<size_t>(1, MIN_WORK / (size + 1));
+    auto start = benchmark_clock::now();
+    for (size_t i = 0; i < repeats; i++)
+        run();
+    auto elapsed = benchmark_clock::now() - start;
+    measurement m;
+    m.operation = operation;
+    m.size = size;
+    m.operations = operationsPerRun * repeats;
+    m.nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    return m;
+}
+
+// like measure(), but each run gets its own copy of `input`, all made
+// before the clock starts - for operations that consume their queue
+template<typename T, typename F>
+measurement measureOn(const std::string& operation, size_t size,
+                      size_t operationsPerRun, const T& input, F run) {
+    size_t repeats = std::max<size_t>(1, MIN_WORK / (size + 1));
+    std::vector<T> inputs(repeats, input);
+    auto start = benchmark_clock::now();
+    for (size_t i = 0; i < repeats; i++)
+        run(inputs[i]);
+    auto elapsed = benchmark_clock::now() - start;
+    measurement m;
+    m.operation = operation;
+    m.size = size;
+    m.operations = operationsPerRun * repeats;
+    m.nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    return m;
+}
+
+bool first_record = true;
+
+void report(const measurement& m, const std::string& valueType,
+            const std::string& distribution,
+            const std::string& queue = "PriorityQueue") {
+    std::cout << (first_record ? "[\n" : ",\n");
+    first_record = false;
+    std::cout << "  {\"queue\": \"" << queue << "\""
+              << ", \"operation\": \"" << m.operation << "\""
+              << ", \"size\": " << m.size
+              << ", \"key_type\": \"int\""
+              << ", \"value_type\": \"" << valueType << "\""
+              << ", \"distribution\": \"" << distribution << "\""
+              << ", \"operations\": " << m.operations
+              << ", \"total_ns\": " << static_cast<uint64_t>(m.nanoseconds)
+              << ", \"ns_per_op\": "
+              << (m.operations ? m.nanoseconds / m.operations : 0.0) << "}";
+}
+
+template<typename V>
+void benchmarkQueue(const std::string& valueType,
+                    const std::string& distribution, size_t n) {
+    typedef PriorityQueue<int, V> queue_type;
+    std::mt19937_64 random(n * 31 + distribution.size());
+
+    std::vector<uint64_t> raw = numbers(distribution, n, random);
+    std::vector<V> values;
+    values.reserve(n);
+    for (auto x : raw)
+        values.push_back(makeValue<V>(x));
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; i++)
+        keys[i] = static_cast<int>(random() % (n + 1));
+
+    std::vector<uint64_t> rawUpdates = numbers(distribution, n, random);
+    std::vector<V> updates;
+    updates.reserve(n);
+    for (auto x : rawUpdates)
+        updates.push_back(makeValue<V>(x));
+
+    auto emit = [&](const measurement& m) {
+        report(m, valueType, distribution);
+    };
+
+    queue_type base;
+    for (size_t i = 0; i < n; i++)
+        base.insert(keys[i], values[i]);
+
+    emit(measureOn("insert", n, n, queue_type(), [&](queue_type& q) {
+        for (size_t i = 0; i < n; i++)
+            q.insert(keys[i], values[i]);
+        escape(&q);
+    }));
+
+    emit(measureOn("copy", n, n, queue_type(), [&](queue_type& q) {
+        q = base;
+        escape(&q);
+    }));
+
+    queue_type same(base);
+    emit(measure("operator==", n, n, [&] {
+        escape(&same);
+        sink = sink + (same == base);
+    }));
+
+    {
+        queue_type q(base);
+        emit(measure("changeValue", n, n, [&] {
+            for (size_t i = 0; i < n; i++)
+                q.changeValue(keys[i], updates[i]);
+            escape(&q);
+        }));
+    }
+
+    emit(measureOn("deleteMin", n, n, base, [&](queue_type& q) {
+        while (!q.empty())
+            q.deleteMin();
+        escape(&q);
+    }));
+
+    emit(measureOn("deleteMax", n, n, base, [&](queue_type& q) {
+        while (!q.empty())
+            q.deleteMax();
+        escape(&q);
+    }));
+
+    std::pair<queue_type, queue_type> halves;
+    for (size_t i = 0; i < n; i++)
+        (i % 2 ? halves.second : halves.first).insert(keys[i], values[i]);
+    emit(measureOn("merge", n, 1, halves,
+                   [&](std::pair<queue_type, queue_type>& h) {
+        h.first.merge(h.second);
+        escape(&h);
+    }));
+
+    // a steady-state mix: 50% insert, 30% deleteMin, 20% changeValue
+    emit(measureOn("mixed", n, n, base, [&](queue_type& q) {
+        for (size_t i = 0; i < n; i++) {
+            switch (i % 10) {
+                case 0: case 2: case 4: case 6: case 8:
+                    q.insert(keys[i], updates[i]);
+                    break;
+                case 1: case 5: case 9:
+                    q.deleteMin();
+                    break;
+                default:
+                    try {
+                        q.changeValue(keys[i], updates[i]);
+                    } catch (const PriorityQueueNotFoundException&) {
+                    }
+            }
+        }
+        escape(&q);
+    }));
+}
+
+// the operations both queues share, on n <= capacity int pairs; drains read
+// the minimum or maximum on every step, so that no queue can get away with
+// doing less than the other
+template<typename Q>
+void benchmarkSmallQueue(const std::string& queue,
+                         const std::string& distribution,
+                         const std::vector<int>& keys,
+                         const std::vector<int>& values,
+                         const std::vector<int>& updates) {
+    size_t n = keys.size();
+    auto emit = [&](const measurement& m) {
+        report(m, "int", distribution, queue);
+    };
+
+    Q base;
+    for (size_t i = 0; i < n; i++)
+        base.insert(keys[i], values[i]);
+
+    emit(measureOn("insert", n, n, Q(), [&](Q& q) {
+        for (size_t i = 0; i < n; i++)
+            q.insert(keys[i], values[i]);
+        escape(&q);
+    }));
+
+    emit(measureOn("copy", n, n, Q(), [&](Q& q) {
+        q = base;
+        escape(&q);
+    }));
+
+    Q same(base);
+    emit(measure("operator==", n, n, [&] {
+        escape(&same);
+        sink = sink + (same == base);
+    }));
+
+    {
+        Q q(base);
+        emit(measure("changeValue", n, n, [&] {
+            for (size_t i = 0; i < n; i++)
+                q.changeValue(keys[i], updates[i]);
+            escape(&q);
+        }));
+    }
+
+    emit(measureOn("deleteMin", n, n, base, [&](Q& q) {
+        size_t sum = 0;
+        while (!q.empty()) {
+            sum += q.minValue();
+            q.deleteMin();
+        }
+        escape(&q);
+        sink = sink + sum;
+    }));
+
+    emit(measureOn("deleteMax", n, n, base, [&](Q& q) {
+        size_t sum = 0;
+        while (!q.empty()) {
+            sum += q.maxValue();
+            q.deleteMax();
+        }
+        escape(&q);
+        sink = sink + sum;
+    }));
+
+    std::pair<Q, Q> halves;
+    for (size_t i = 0; i < n; i++)
+        (i % 2 ? halves.second : halves.first).insert(keys[i], values[i]);
+    emit(measureOn("merge", n, 1, halves, [&](std::pair<Q, Q>& h) {
+        h.first.merge(h.second);
+        escape(&h);
+        sink = sink + h.first.minValue();
+    }));
+}
+
+template<size_t N>
+void benchmarkStatic(const std::string& distribution) {
+    std::mt19937_64 random(N * 37 + distribution.size());
+    std::vector<int> keys(N), values(N), updates(N);
+    std::vector<uint64_t> raw = numbers(distribution, N, random);
+    std::vector<uint64_t> rawUpdates = numbers(distribution, N, random);
+    for (size_t i = 0; i < N; i++) {
+        keys[i] = static_cast<int>(random() % (N + 1));
+        values[i] = makeValue<int>(raw[i]);
+        updates[i] = makeValue<int>(rawUpdates[i]);
+    }
+
+    benchmarkSmallQueue<StaticPriorityQueue<int, int, N> >(
+        "StaticPriorityQueue", distribution, keys, values, updates);
+    benchmarkSmallQueue<PriorityQueue<int, int> >(
+        "PriorityQueue", distribution, keys, values, updates);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxSize = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    if (maxSize > 10000000)
+        maxSize = 10000000;
+
+    const char* distributions[] = {"uniform", "skewed", "duplicates"};
+    for (size_t n = 10; n <= maxSize; n *= 10) {
+        for (auto distribution : distributions) {
+            benchmarkQueue<int>("int", distribution, n);
+            benchmarkQueue<std::string>("string", distribution, n);
+            benchmarkQueue<std::vector<int> >("vector<int>", distribution, n);
+        }
+    }
+    for (auto distribution : distributions) {
+        benchmarkStatic<16>(distribution);
+        benchmarkStatic<64>(distribution);
+        benchmarkStatic<256>(distribution);
+    }
+    std::cout << (first_record ? "[]\n" : "\n]\n");
+    return 0;
+}
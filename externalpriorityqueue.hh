@@ -0,0 +1,527 @@
+#ifndef EXTERNALPRIORITYQUEUE_HH_
+#define EXTERNALPRIORITYQUEUE_HH_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <fstream>
+#include <future>
+#include <system_error>
+
+#include "priorityqueue.hh"
+
+/* Priority queue for more pairs than fit in memory.
+ *
+ * New pairs go to an in-memory PriorityQueue (the head). Once the head holds
+ * memoryPairs pairs, its upper half (by (value, key)) is written to a sorted
+ * run file in `directory` and dropped from memory. deleteMin takes the
+ * smallest of the head minimum and the first unread pair of every run; runs
+ * are read sequentially, blockPairs pairs at a time, and the block after the
+ * current one is prefetched on another thread. The runs are also kept in a
+ * heap by their first unread pair, so finding the minimum is O(1) and
+ * taking it from a run O(log runCount()).
+ *
+ * Runs are kept in levels, like in a sequence heap: spilled runs are on
+ * level 0, and once a level holds maxRuns runs they are merged into a single
+ * run on the next level. A pair is thus rewritten O(log_maxRuns(n /
+ * memoryPairs)) times and there are at most maxRuns - 1 runs per level.
+ * Run files are named after the process and the queue, so queues (of this
+ * or other processes) can share the directory, and are removed as soon as
+ * they are drained.
+ *
+ * Keys and values go through PriorityQueueSerializer, like
+ * PriorityQueue::save(). Pairs are ordered by (value, key). All operations
+ * give the strong guarantee, I/O errors are reported with
+ * PriorityQueueIOException. */
+template<typename K, typename V>
+class ExternalPriorityQueue {
+
+    public:
+
+        typedef size_t size_type;
+        typedef K key_type;
+        typedef V value_type;
+
+        explicit ExternalPriorityQueue(const std::string& directory,
+                                       size_type memoryPairs = 1 << 20,
+                                       size_type blockPairs = 1 << 12,
+                                       size_type maxRuns = 16);
+        ExternalPriorityQueue(const ExternalPriorityQueue<K, V>&) = delete;
+        ExternalPriorityQueue<K, V>& operator=(
+            const ExternalPriorityQueue<K, V>&) = delete;
+
+        bool empty() const;
+        size_type size() const;
+        size_type runCount() const;
+        void insert(const K& key, const V& value);
+        const V& minValue() const;
+        const K& minKey() const;
+        void deleteMin();
+
+    private:
+        typedef std::pair<K, V> record;
+        typedef std::vector<record> block_type;
+
+        /* one sorted file; block `blockIndex` of it is in memory, the next
+         * one is (possibly) being read by `pending` */
+        struct run {
+            std::string path;
+            uint64_t count;
+            size_type blockPairs;
+            std::vector<uint64_t> offsets; // of every block, and of the end
+            std::ifstream file;
+            size_type blockIndex;
+            block_type block;
+            size_type next;
+            std::future<block_type> pending;
+            size_type level;
+
+            run(const std::string& path, uint64_t count, size_type blockPairs,
+                const std::vector<uint64_t>& offsets);
+            ~run();
+
+            size_type blocks() const {
+                return offsets.size() - 1;
+            }
+
+            const record& front() const {
+                return block[next];
+            }
+
+            block_type readBlock(std::istream& in, size_type index) const;
+            void prefetch();
+            bool pop();
+        };
+
+        /* writes a run file; removes it again unless finish() succeeds */
+        class runWriter {
+            public:
+                runWriter(const std::string& path, size_type blockPairs);
+                ~runWriter();
+                void push(const K& key, const V& value);
+                std::unique_ptr<run> finish();
+
+            private:
+                std::string path;
+                size_type blockPairs;
+                uint64_t count;
+                std::vector<uint64_t> offsets;
+                std::ofstream out;
+                bool done;
+        };
+
+        /* reads what is left of a run through its own stream, so that
+         * merging does not disturb the run itself */
+        class runCursor {
+            public:
+                explicit runCursor(const run& source);
+                bool valid() const;
+                const record& front() const;
+                void pop();
+
+            private:
+                const run& source;
+                std::ifstream in;
+                size_type blockIndex;
+                block_type loaded;
+                const block_type* current;
+                size_type next;
+        };
+
+        static bool less(const K& lkey, const V& lval,
+                         const K& rkey, const V& rval);
+        static bool laterFront(const run* lhs, const run* rhs);
+        const run* smallestRun() const;
+        void rebuildFronts();
+        std::string nextRunPath();
+        void spill();
+        void mergeRuns(size_type level);
+
+        std::string directory;
+        size_type memoryPairs;
+        size_type blockPairs;
+        size_type maxRuns;
+        size_type pairs;
+        uint64_t runsCreated;
+        PriorityQueue<K, V> head;
+        std::vector<std::unique_ptr<run> > runs;
+        std::vector<run*> fronts; // heap of runs, smallest front on top
+};
+
+/******************** Runs ********************/
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::run::run(const std::string& path, uint64_t count,
+    size_type blockPairs, const std::vector<uint64_t>& offsets)
+    : path(path), count(count), blockPairs(blockPairs), offsets(offsets),
+      file(path.c_str(), std::ios::binary), blockIndex(0), next(0),
+      level(0) {
+    if (!file)
+        throw PriorityQueueIOException();
+    block = readBlock(file, 0);
+    prefetch();
+}
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::run::~run() {
+    if (pending.valid())
+        pending.wait();
+    file.close();
+    remove(path.c_str());
+}
+
+/* COMPLEXITY - O(blockPairs), one seek and a sequential read */
+template<typename K, typename V>
+typename ExternalPriorityQueue<K, V>::block_type
+ExternalPriorityQueue<K, V>::run::readBlock(std::istream& in,
+                                            size_type index) const {
+    uint64_t first = static_cast<uint64_t>(index) * blockPairs;
+    uint64_t length = std::min<uint64_t>(blockPairs, count - first);
+
+    in.clear();
+    if (!in.seekg(offsets[index]))
+        throw PriorityQueueIOException();
+    block_type result;
+    result.reserve(length);
+    for (uint64_t i = 0; i < length; ++i) {
+        K key = PriorityQueueSerializer<K>::read(in);
+        V val = PriorityQueueSerializer<V>::read(in);
+        result.push_back(record(key, val));
+    }
+    return result;
+}
+
+/* starts reading the next block in the background; if no thread can be
+ * started the block is simply read when it is needed */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::run::prefetch() {
+    if (blockIndex + 1 >= blocks())
+        return;
+    size_type index = blockIndex + 1;
+    try {
+        pending = std::async(std::launch::async, [this, index] {
+            return readBlock(file, index);
+        });
+    } catch (const std::system_error&) {
+    }
+}
+
+/* drops the front pair, returns false when the run is drained; a failed
+ * read leaves the run as it was */
+/* COMPLEXITY - O(1) amortized */
+template<typename K, typename V>
+bool ExternalPriorityQueue<K, V>::run::pop() {
+    if (next + 1 < block.size()) {
+        ++next;
+        return true;
+    }
+    if (blockIndex + 1 >= blocks())
+        return false;
+
+    block_type fetched = pending.valid() ? pending.get()
+                                         : readBlock(file, blockIndex + 1);
+    block.swap(fetched);
+    next = 0;
+    ++blockIndex;
+    prefetch();
+    return true;
+}
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::runWriter::runWriter(const std::string& path,
+    size_type blockPairs)
+    : path(path), blockPairs(blockPairs), count(0),
+      out(path.c_str(), std::ios::binary | std::ios::trunc), done(false) {
+    if (!out)
+        throw PriorityQueueIOException();
+}
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::runWriter::~runWriter() {
+    if (!done) {
+        out.close();
+        remove(path.c_str());
+    }
+}
+
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::runWriter::push(const K& key,
+                                                  const V& value) {
+    if (count % blockPairs == 0)
+        offsets.push_back(static_cast<uint64_t>(out.tellp()));
+    PriorityQueueSerializer<K>::write(out, key);
+    PriorityQueueSerializer<V>::write(out, value);
+    if (!out)
+        throw PriorityQueueIOException();
+    ++count;
+}
+
+template<typename K, typename V>
+std::unique_ptr<typename ExternalPriorityQueue<K, V>::run>
+ExternalPriorityQueue<K, V>::runWriter::finish() {
+    offsets.push_back(static_cast<uint64_t>(out.tellp()));
+    out.close();
+    if (!out)
+        throw PriorityQueueIOException();
+    std::unique_ptr<run> result(new run(path, count, blockPairs, offsets));
+    done = true;
+    return result;
+}
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::runCursor::runCursor(const run& source)
+    : source(source), in(source.path.c_str(), std::ios::binary),
+      blockIndex(source.blockIndex), current(&source.block),
+      next(source.next) {
+    if (!in)
+        throw PriorityQueueIOException();
+}
+
+template<typename K, typename V>
+bool ExternalPriorityQueue<K, V>::runCursor::valid() const {
+    return next < current->size();
+}
+
+template<typename K, typename V>
+const typename ExternalPriorityQueue<K, V>::record&
+ExternalPriorityQueue<K, V>::runCursor::front() const {
+    return (*current)[next];
+}
+
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::runCursor::pop() {
+    if (++next < current->size() || blockIndex + 1 >= source.blocks())
+        return;
+    loaded = source.readBlock(in, ++blockIndex);
+    current = &loaded;
+    next = 0;
+}
+
+/******************** Queue ********************/
+
+template<typename K, typename V>
+ExternalPriorityQueue<K, V>::ExternalPriorityQueue(
+    const std::string& directory, size_type memoryPairs,
+    size_type blockPairs, size_type maxRuns)
+    : directory(directory), memoryPairs(memoryPairs < 2 ? 2 : memoryPairs),
+      blockPairs(blockPairs < 1 ? 1 : blockPairs),
+      maxRuns(maxRuns < 2 ? 2 : maxRuns), pairs(0), runsCreated(0) {
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+bool ExternalPriorityQueue<K, V>::empty() const {
+    return pairs == 0;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+typename ExternalPriorityQueue<K, V>::size_type
+ExternalPriorityQueue<K, V>::size() const {
+    return pairs;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+typename ExternalPriorityQueue<K, V>::size_type
+ExternalPriorityQueue<K, V>::runCount() const {
+    return runs.size();
+}
+
+template<typename K, typename V>
+bool ExternalPriorityQueue<K, V>::less(const K& lkey, const V& lval,
+                                       const K& rkey, const V& rval) {
+    if (lval < rval)
+        return true;
+    else if (rval < lval)
+        return false;
+    return lkey < rkey;
+}
+
+/* heap order of `fronts`: the run with the smallest front goes on top */
+template<typename K, typename V>
+bool ExternalPriorityQueue<K, V>::laterFront(const run* lhs, const run* rhs) {
+    return less(rhs->front().first, rhs->front().second,
+                lhs->front().first, lhs->front().second);
+}
+
+/* run holding the overall minimum, nullptr if that is in the head */
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+const typename ExternalPriorityQueue<K, V>::run*
+ExternalPriorityQueue<K, V>::smallestRun() const {
+    if (fronts.empty())
+        return nullptr;
+    const run* best = fronts.front();
+    if (!head.empty() && !less(best->front().first, best->front().second,
+                               head.minKey(), head.minValue())) {
+        return nullptr;
+    }
+    return best;
+}
+
+/* puts every run back into the heap; fronts has room for all of them */
+/* COMPLEXITY - O(runCount()) */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::rebuildFronts() {
+    fronts.clear();
+    for (auto it = runs.begin(); it != runs.end(); ++it)
+        fronts.push_back(it->get());
+    std::make_heap(fronts.begin(), fronts.end(), laterFront);
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+const V& ExternalPriorityQueue<K, V>::minValue() const {
+    if (empty())
+        throw PriorityQueueEmptyException();
+    const run* best = smallestRun();
+    return best == nullptr ? head.minValue() : best->front().second;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V>
+const K& ExternalPriorityQueue<K, V>::minKey() const {
+    if (empty())
+        throw PriorityQueueEmptyException();
+    const run* best = smallestRun();
+    return best == nullptr ? head.minKey() : best->front().first;
+}
+
+/* COMPLEXITY - O(log(memoryPairs)) amortized, plus the amortized cost of
+ * spilling and merging */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::insert(const K& key, const V& value) {
+    if (head.size() >= memoryPairs)
+        spill();
+    head.insert(key, value);
+    ++pairs;
+}
+
+/* The run is taken off the heap while it pops, and goes back in (or away,
+ * if drained) only after that; a failed read puts it back as it was. */
+/* COMPLEXITY - O(log(runCount()) + log(memoryPairs)) amortized, plus
+ * O(runCount()) when a run is drained */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::deleteMin() {
+    if (empty())
+        return;
+    if (smallestRun() == nullptr) {
+        head.deleteMin();
+        --pairs;
+        return;
+    }
+
+    std::pop_heap(fronts.begin(), fronts.end(), laterFront);
+    run* best = fronts.back();
+    bool more;
+    try {
+        more = best->pop();
+    } catch (...) {
+        std::push_heap(fronts.begin(), fronts.end(), laterFront);
+        throw;
+    }
+    if (more) {
+        std::push_heap(fronts.begin(), fronts.end(), laterFront);
+    } else {
+        fronts.pop_back();
+        for (auto it = runs.begin(); it != runs.end(); ++it) {
+            if (it->get() == best) {
+                runs.erase(it);
+                break;
+            }
+        }
+    }
+    --pairs;
+}
+
+template<typename K, typename V>
+std::string ExternalPriorityQueue<K, V>::nextRunPath() {
+    return directory + "/pq-run-" + std::to_string(getpid()) + "-" +
+        std::to_string(reinterpret_cast<uintptr_t>(this)) + "-" +
+        std::to_string(runsCreated++) + ".bin";
+}
+
+/* Moves the upper half of the head, by (value, key), to a new run. Splitting
+ * by position rather than by value keeps this working for duplicate-heavy
+ * values: at least half of the head always leaves. The upper half is only
+ * erased from the head once the run is written, which cannot throw. */
+/* COMPLEXITY - O(memoryPairs) */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::spill() {
+    runs.reserve(runs.size() + 1);
+    fronts.reserve(runs.size() + 1);
+
+    auto median = head.begin();
+    std::advance(median, head.size() / 2);
+
+    runWriter writer(nextRunPath(), blockPairs);
+    for (auto it = median; it != head.end(); ++it)
+        writer.push(it->key, it->val);
+
+    std::unique_ptr<run> spilledRun = writer.finish();
+
+    head.erase(median, head.end());
+    runs.push_back(std::move(spilledRun));
+    fronts.push_back(runs.back().get());
+    std::push_heap(fronts.begin(), fronts.end(), laterFront);
+
+    for (size_type level = 0; ; ++level) {
+        size_type onLevel = 0;
+        for (auto it = runs.begin(); it != runs.end(); ++it)
+            onLevel += (*it)->level == level;
+        if (onLevel < maxRuns)
+            break;
+        mergeRuns(level);
+    }
+}
+
+/* k-way merge of the runs on `level` into one run on the level above; the
+ * old runs are only dropped once the merged one is complete */
+/* COMPLEXITY - O(unread pairs in the merged runs * maxRuns) */
+template<typename K, typename V>
+void ExternalPriorityQueue<K, V>::mergeRuns(size_type level) {
+    std::vector<std::unique_ptr<runCursor> > cursors;
+    cursors.reserve(maxRuns);
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        if ((*it)->level == level)
+            cursors.push_back(std::unique_ptr<runCursor>(new runCursor(**it)));
+    }
+
+    runWriter writer(nextRunPath(), blockPairs);
+    while (true) {
+        runCursor* best = nullptr;
+        for (auto it = cursors.begin(); it != cursors.end(); ++it) {
+            if ((*it)->valid() &&
+                (best == nullptr ||
+                 less((*it)->front().first, (*it)->front().second,
+                      best->front().first, best->front().second))) {
+                best = it->get();
+            }
+        }
+        if (best == nullptr)
+            break;
+        writer.push(best->front().first, best->front().second);
+        best->pop();
+    }
+    std::unique_ptr<run> merged = writer.finish();
+    merged->level = level + 1;
+    cursors.clear();
+
+    size_type kept = 0;
+    for (size_type i = 0; i < runs.size(); ++i) {
+        if (runs[i]->level != level)
+            runs[kept++] = std::move(runs[i]);
+    }
+    runs.erase(runs.begin() + kept, runs.end());
+    runs.push_back(std::move(merged));
+    rebuildFronts();
+}
+
+#endif /* EXTERNALPRIORITYQUEUE_HH_ */
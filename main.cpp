@@ -3,6 +3,9 @@
 #include <cassert>
 
 #include "priorityqueue.hh"
+#include "externalpriorityqueue.hh"
+#include "timingwheelqueue.hh"
+#include "staticpriorityqueue.hh"
 
 PriorityQueue<int, int> f(PriorityQueue<int, int> q)
 {
@@ -372,11 +375,717 @@ void testWeirdThings() {
     cerr << "test weird things finished\n";
 }
 
+void testErase() {
+    PriorityQueue<int, int> P;
+    for (int i = 0; i < 100; i++)
+        P.insert(i % 10, i);
+    P.insert(3, 3);
+    P.insert(3, 3);
+
+    assert(P.countKey(3) == 12);
+    assert(P.countKey(42) == 0);
+    assert(P.countInValueRange(10, 19) == 10);
+    assert(P.countInValueRange(3, 3) == 3);
+    assert(P.countInValueRange(19, 10) == 0);
+
+    assert(P.eraseKey(3) == 12);
+    assert(P.countKey(3) == 0);
+    assert(P.size() == 90);
+    assert(P.eraseKey(3) == 0);
+
+    assert(P.eraseValuesAbove(97) == 2);
+    assert(P.maxValue() == 97);
+    assert(P.eraseValuesBelow(50) == 45);
+    assert(P.minValue() == 50);
+    assert(P.size() == 43);
+    assert(P.countKey(0) == 5);
+    assert(P.countInValueRange(0, 1000) == P.size());
+
+    // by position: the upper half of the (value, key) order
+    auto median = P.begin();
+    std::advance(median, 20);
+    int kept = median->val;
+    assert(P.erase(median, P.end()) == 23);
+    assert(P.size() == 20 && P.maxValue() < kept);
+    assert(P.countKey(0) == 3 && P.erase(P.end(), P.end()) == 0);
+
+    PriorityQueue<int, int> Q;
+    assert(Q.eraseValuesBelow(1) == 0);
+    assert(Q.eraseValuesAbove(1) == 0);
+    assert(Q.eraseKey(1) == 0);
+
+    PriorityQueue<int, CompareThrower> R;
+    for (int i = 0; i < 10; i++)
+        R.insert(i, CompareThrower{});
+    PriorityQueue<int, CompareThrower> backup(R);
+    try {
+        THROW_NOW_THIS_IS_MADNESS = true;
+        R.eraseValuesBelow(CompareThrower{});
+        assert(!"did not throw");
+    }
+    catch (WeirdException &) {
+    }
+    THROW_NOW_THIS_IS_MADNESS = false;
+    assert(R.size() == backup.size());
+    assert(R.eraseKey(5) == 1);
+    assert(R.size() == 9);
+}
+
+void testIterators() {
+    PriorityQueue<int, int> P;
+    const PriorityQueue<int, int>& C = P;
+    assert(C.begin() == C.end());
+    assert(C.byKey().empty());
+
+    P.insert(3, 10);
+    P.insert(1, 30);
+    P.insert(2, 20);
+    P.insert(1, 5);
+
+    int values[] = {5, 10, 20, 30};
+    int i = 0;
+    for (const auto& entry : C) {
+        assert(entry.val == values[i++]);
+    }
+    assert(i == 4);
+
+    int keys[] = {1, 1, 2, 3};
+    i = 0;
+    for (const auto& entry : C.byKey()) {
+        assert(entry.key == keys[i++]);
+    }
+    assert(i == 4);
+
+    auto last = C.end();
+    --last;
+    assert(last->key == C.maxKey() && &last->val == &C.maxValue());
+
+    auto ones = C.equal_range(1);
+    auto it = ones.begin();
+    assert(it->val == 5);
+    assert((++it)->val == 30);
+    assert(++it == ones.end());
+    assert(C.equal_range(42).empty());
+
+#if __cplusplus >= 202002L
+    static_assert(std::bidirectional_iterator<
+        PriorityQueue<int, int>::const_iterator>);
+    static_assert(std::ranges::bidirectional_range<
+        PriorityQueue<int, int>::key_range>);
+    static_assert(std::ranges::view<PriorityQueue<int, int>::value_range>);
+
+    auto big = C.byValue()
+        | std::views::filter([](const auto& e) { return e.val >= 10; })
+        | std::views::transform([](const auto& e) { return e.key; });
+    assert(std::ranges::distance(big) == 3);
+    assert(*big.begin() == 3);
+#endif
+}
+
+#ifdef PRIORITYQUEUE_STATS
+void testStats() {
+    typedef PriorityQueue<long, long> queue_type;
+    queue_type P, Q;
+    PriorityQueueStats& stats = P.stats();
+    for (long i = 0; i < 100; i++)
+        P.insert(i, 100 - i);
+    assert(stats.allocations == 100);
+    assert(stats.peakSize == 100);
+    assert(stats.calls[PriorityQueueStats::INSERT] == 100);
+    assert(stats.descents[PriorityQueueStats::INSERT] == 200);
+    assert(stats.comparisons > 0);
+
+    uint64_t comparisons = stats.comparisons;
+    P.minValue();
+    P.deleteMin();
+    assert(stats.comparisons == comparisons);
+    assert(stats.frees == 1);
+
+    P.changeValue(5, 5);
+    assert(stats.allocations == 101 && stats.frees == 2);
+    assert(P.eraseValuesBelow(50) == 49);
+    assert(stats.frees == 51);
+
+    uint64_t total = 0;
+    for (size_t b = 0; b < PriorityQueueStats::LATENCY_BUCKETS; b++)
+        total += stats.latency[PriorityQueueStats::INSERT][b];
+    assert(total == 100);
+    assert(std::string(PriorityQueueStats::methodName(
+        PriorityQueueStats::DELETE_MIN)) == "deleteMin");
+    P.countKey(7);
+    assert(stats.descents[PriorityQueueStats::COUNT_KEY] == 1);
+    assert(stats.descents[PriorityQueueStats::INSERT] == 200);
+
+    // every queue counts for itself
+    Q.insert(1, 1);
+    assert(Q.stats().calls[PriorityQueueStats::INSERT] == 1);
+    assert(Q.stats().peakSize == 1 && Q.stats().allocations == 1);
+    assert(stats.calls[PriorityQueueStats::INSERT] == 100);
+    assert(stats.allocations == 101);
+
+    // the copies operator= and merge make are theirs, not separate copies
+    queue_type R;
+    R = P;
+    assert(R.stats().calls[PriorityQueueStats::ASSIGN] == 1);
+    assert(R.stats().calls[PriorityQueueStats::COPY] == 0);
+    assert(R.stats().allocations == P.size());
+    assert(R.stats().peakSize == P.size());
+    R.merge(Q);
+    assert(R.stats().calls[PriorityQueueStats::MERGE] == 1);
+    assert(R.stats().calls[PriorityQueueStats::COPY] == 0);
+    queue_type S(P);
+    assert(S.stats().calls[PriorityQueueStats::COPY] == 1);
+    assert(stats.calls[PriorityQueueStats::COPY] == 0);
+
+    // counters stay with the queue, not with what it holds
+    swap(P, R);
+    assert(&P.stats() == &stats);
+    assert(stats.calls[PriorityQueueStats::INSERT] == 100);
+    stats.reset();
+    assert(stats.allocations == 0 && R.stats().allocations != 0);
+
+    // a queue destroyed inside another one's method frees for that one, so
+    // once everything is gone the outer queue's counters balance
+    PriorityQueue<long, queue_type> N;
+    queue_type inner;
+    for (long i = 0; i < 10; i++)
+        inner.insert(i, i);
+    N.insert(1, inner);
+    N.insert(2, inner);
+    assert(N.stats().allocations == 22);
+    N.deleteMin();
+    N.eraseKey(2);
+    assert(N.empty());
+    assert(N.stats().allocations == N.stats().frees);
+    assert(inner.stats().calls[PriorityQueueStats::COPY] == 0);
+}
+#endif
+
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+
+struct CountingResource : public std::pmr::memory_resource {
+    size_t allocations = 0;
+    size_t outstanding = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        ++outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        --outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+        noexcept override {
+        return this == &other;
+    }
+};
+
+void testAllocator() {
+    CountingResource counting, other;
+    {
+        PmrPriorityQueue<int, int> P(&counting);
+        assert(P.get_allocator().resource() == &counting);
+        P.insert(1, 10);
+        // the pair (with its control block) and one node in each set
+        assert(counting.allocations == 3);
+        for (int i = 2; i <= 100; i++)
+            P.insert(i, 1000 - i);
+        assert(counting.allocations == 300);
+
+        PmrPriorityQueue<int, int> Q(P, &counting);
+        assert(Q == P);
+        assert(counting.allocations == 600);
+
+        PmrPriorityQueue<int, int> R(&other);
+        R.insert(0, 0);
+        R = P;
+        assert(R.get_allocator().resource() == &other);
+        assert(counting.allocations == 600 && other.allocations == 303);
+
+        // pairs from a different resource are copied, not shared
+        PmrPriorityQueue<int, int> S(&other);
+        S.insert(-1, -1);
+        Q.merge(S);
+        assert(S.empty());
+        assert(Q.minKey() == -1 && Q.size() == 101);
+
+        PmrPriorityQueue<int, int> T(std::move(P));
+        assert(T.get_allocator().resource() == &counting);
+        assert(T.size() == 100 && P.empty());
+    }
+    assert(counting.outstanding == 0 && other.outstanding == 0);
+
+    // a per-request arena backs every node of the queue
+    {
+        std::pmr::monotonic_buffer_resource arena(1 << 16, &counting);
+        size_t before = counting.allocations;
+        PmrPriorityQueue<int, std::string> P(&arena);
+        for (int i = 0; i < 200; i++)
+            P.insert(i, std::to_string(i));
+        P.deleteMin();
+        P.changeValue(5, "x");
+        assert(P.size() == 199 && P.maxValue() == "x");
+        assert(counting.allocations - before <= 2);
+    }
+    assert(counting.outstanding == 0);
+}
+
+template<>
+struct PriorityQueueSerializer<std::string> {
+    static void write(std::ostream& out, const std::string& s) {
+        size_t length = s.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(s.data(), length);
+    }
+
+    static std::string read(std::istream& in) {
+        size_t length;
+        if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)))
+            throw PriorityQueueIOException();
+        std::string s(length, '\0');
+        if (!in.read(&s[0], length))
+            throw PriorityQueueIOException();
+        return s;
+    }
+};
+
+struct SaveThrower {
+    int id;
+    bool operator<(const SaveThrower& other) const { return id < other.id; }
+    bool operator==(const SaveThrower& other) const { return id == other.id; }
+};
+
+template<>
+struct PriorityQueueSerializer<SaveThrower> {
+    static void write(std::ostream& out, const SaveThrower& s) {
+        if (s.id < 0)
+            throw WeirdException("save fail");
+        out.write(reinterpret_cast<const char*>(&s.id), sizeof(s.id));
+    }
+
+    static SaveThrower read(std::istream& in) {
+        SaveThrower s;
+        if (!in.read(reinterpret_cast<char*>(&s.id), sizeof(s.id)))
+            throw PriorityQueueIOException();
+        return s;
+    }
+};
+
+void testSnapshot() {
+    std::string path =
+        (std::filesystem::temp_directory_path() / "pq_snapshot_test").string();
+
+    PriorityQueue<int, double> P;
+    for (int i = 0; i < 1000; i++)
+        P.insert(i % 37, (i * 7919) % 1000 / 10.0);
+    P.save(path);
+
+    PriorityQueue<int, double> Q;
+    Q.insert(1, 1);
+    Q.load(path);
+    assert(P == Q);
+    assert(Q.minValue() == P.minValue() && Q.maxKey() == P.maxKey());
+    Q.changeValue(5, -1);
+    Q.deleteMin();
+    assert(Q.size() == 999);
+
+    PriorityQueue<int, double> E;
+    E.save(path);
+    Q.load(path);
+    assert(Q.empty());
+
+    PriorityQueue<std::string, std::string> S, T;
+    S.insert("b", "two");
+    S.insert("a", "three");
+    S.insert("", "");
+    S.save(path);
+    T.load(path);
+    assert(S == T);
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('X');
+    }
+    try {
+        T.load(path);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueIOException&) {
+    }
+    assert(S == T);
+
+    // a failed save keeps the previous snapshot and cleans up after itself
+    PriorityQueue<int, SaveThrower> U, V;
+    U.insert(1, SaveThrower{1});
+    U.save(path);
+    U.insert(2, SaveThrower{-1});
+    try {
+        U.save(path);
+        assert(!"did not throw");
+    }
+    catch (WeirdException&) {
+    }
+    V.load(path);
+    assert(V.size() == 1 && V.minKey() == 1);
+    for (auto& entry : std::filesystem::directory_iterator(
+             std::filesystem::temp_directory_path())) {
+        assert(entry.path().filename().string().find(
+                   "pq_snapshot_test.tmp") != 0);
+    }
+
+    std::filesystem::remove(path);
+    try {
+        T.load(path);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueIOException&) {
+    }
+    assert(S == T);
+}
+
 #include <random>
 
 std::mt19937 twister(std::random_device{}());
 std::uniform_int_distribution<int> distribution(0, 10);
 
+void testTimingWheel() {
+    TimingWheelPriorityQueue<int, uint64_t> W;
+    PriorityQueue<int, uint64_t> reference;
+    std::vector<std::pair<int, uint64_t> > expired;
+
+    assert(W.empty());
+    try {
+        W.minKey();
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueEmptyException&) {
+    }
+    try {
+        W.changeValue(1, 1);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueNotFoundException&) {
+    }
+
+    uint64_t now = 1000;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 50; i++) {
+            int key = twister() % 500;
+            // mostly near future, sometimes far away or already overdue
+            uint64_t when = now - 100 + twister() % (i % 10 == 0 ? 1000000 : 5000);
+            if (i % 25 == 0)
+                when = now + (uint64_t(twister()) << 20);
+            W.insert(key, when);
+            reference.insert(key, when);
+        }
+        for (int i = 0; i < 10; i++) {
+            int key = twister() % 500;
+            if (reference.countKey(key) == 1) {
+                uint64_t when = now + twister() % 3000;
+                W.changeValue(key, when);
+                reference.changeValue(key, when);
+            }
+        }
+        int cancelled = twister() % 500;
+        assert(W.eraseKey(cancelled) == reference.eraseKey(cancelled));
+        assert(W.countKey(cancelled) == 0);
+
+        assert(W.size() == reference.size());
+        assert(W.minValue() == reference.minValue());
+        assert(W.minKey() == reference.minKey());
+        assert(W.maxValue() == reference.maxValue());
+        assert(W.maxKey() == reference.maxKey());
+
+        // deleteMin cascades the wheel ahead of popExpired
+        for (int i = 0; i < 5 && !reference.empty(); i++) {
+            W.deleteMin();
+            reference.deleteMin();
+            assert(reference.empty() || W.minKey() == reference.minKey());
+        }
+
+        now += twister() % 2000;
+        expired.clear();
+        size_t popped = W.popExpired(now, expired);
+        assert(popped == expired.size());
+        for (size_t i = 0; i < expired.size(); i++) {
+            assert(expired[i].first == reference.minKey());
+            assert(expired[i].second == reference.minValue());
+            assert(expired[i].second <= now);
+            reference.deleteMin();
+        }
+        assert(reference.empty() || reference.minValue() > now);
+        assert(W.size() == reference.size());
+    }
+
+    TimingWheelPriorityQueue<int, uint64_t> C(W), D(W);
+    PriorityQueue<int, uint64_t> drained(reference);
+    for (int i = 0; i < 300; i++)
+        D.insert(1000 + i % 7, now + 50000);  // one slot of equal timestamps
+    for (int i = 0; i < 300; i++)
+        drained.insert(1000 + i % 7, now + 50000);
+    while (!drained.empty()) {
+        assert(D.minValue() == drained.minValue());
+        assert(D.minKey() == drained.minKey());
+        D.deleteMin();
+        drained.deleteMin();
+    }
+    assert(D.empty());
+
+    W.deleteMin();
+    reference.deleteMin();
+    W.deleteMax();
+    reference.deleteMax();
+    assert(W.minKey() == reference.minKey());
+    assert(W.maxKey() == reference.maxKey());
+    assert(C.size() == W.size() + 2);
+
+    TimingWheelPriorityQueue<int, uint64_t> M;
+    M.insert(-1, 1);
+    W.merge(M);
+    assert(M.empty());
+    assert(W.minKey() == -1);
+
+    expired.clear();
+    W.popExpired(~uint64_t(0), expired);
+    assert(W.empty());
+    assert(expired.size() == reference.size() + 1);
+    W.insert(7, 5);
+    assert(W.minValue() == 5);
+    W.popExpired(4, expired);
+    assert(W.size() == 1);
+    W.popExpired(5, expired);
+    assert(W.empty());
+
+    TimingWheelPriorityQueue<int, uint32_t> S;
+    S.insert(1, 4000000000u);
+    S.insert(2, 3);
+    std::vector<std::pair<int, uint32_t> > small;
+    assert(S.popExpired(3999999999u, small) == 1 && small[0].first == 2);
+    assert(S.popExpired(4000000000u, small) == 1 && small[1].first == 1);
+}
+
+#if __cplusplus >= 202002L
+constexpr int staticDrained() {
+    StaticPriorityQueue<int, int, 8> Q, R;
+    Q.insert(1, 50);
+    Q.insert(2, 10);
+    Q.insert(3, 30);
+    R.insert(4, 20);
+    Q.merge(R);
+    Q.changeValue(1, 5);
+    int result = 0;
+    while (!Q.empty()) {
+        result = result * 10 + Q.minKey();
+        Q.deleteMin();
+    }
+    return result;
+}
+static_assert(staticDrained() == 1243);
+
+constexpr bool staticCompared() {
+    StaticPriorityQueue<int, int, 4> Q, R;
+    Q.insert(1, 2);
+    Q.insert(3, 4);
+    R.insert(3, 4);
+    R.insert(1, 2);
+    bool equal = Q == R && !(Q < R) && !(Q != R);
+    R.insert(0, 9);
+    return equal && R < Q && Q > R;
+}
+static_assert(staticCompared());
+#endif
+
+void testStatic() {
+    typedef StaticPriorityQueue<int, int, 64> static_type;
+    static_type Q, R;
+    PriorityQueue<int, int> reference, referenceR;
+
+    assert(Q.empty() && static_type::capacity() == 64);
+    try {
+        Q.minValue();
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueEmptyException&) {
+    }
+    try {
+        Q.changeValue(1, 1);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueNotFoundException&) {
+    }
+
+    for (int i = 0; i < 40; i++) {
+        int key = twister() % 20, value = twister() % 30;
+        Q.insert(key, value);
+        reference.insert(key, value);
+    }
+    for (int i = 0; i < 20; i++) {
+        int key = twister() % 20, value = twister() % 30;
+        R.insert(key, value);
+        referenceR.insert(key, value);
+    }
+    for (int i = 0; i < 20; i++) {
+        int key = twister() % 20, value = twister() % 30;
+        if (reference.countKey(key) == 1) {
+            Q.changeValue(key, value);
+            reference.changeValue(key, value);
+        }
+        assert(Q.countKey(key) == reference.countKey(key));
+    }
+    assert((Q < R) == (reference < referenceR));
+    assert((R < Q) == (referenceR < reference));
+
+    static_type copy(Q);
+    assert(copy == Q && !(copy != Q) && copy <= Q && copy >= Q);
+    copy.deleteMax();
+    assert(copy != Q);
+
+    // a comparison throwing in changeValue loses nothing
+    StaticPriorityQueue<int, CompareThrower, 4> C;
+    for (int i = 0; i < 3; i++)
+        C.insert(i, CompareThrower{});
+    try {
+        THROW_NOW_THIS_IS_MADNESS = true;
+        C.changeValue(1, CompareThrower{});
+        assert(!"did not throw");
+    }
+    catch (WeirdException&) {
+    }
+    THROW_NOW_THIS_IS_MADNESS = false;
+    assert(C.size() == 3);
+    for (int i = 0; i < 3; i++)
+        assert(C.countKey(i) == 1);
+
+    // overflow fails before touching either queue
+    static_type full;
+    for (int i = 0; i < 64; i++)
+        full.insert(i, i);
+    static_type backup(full);
+    try {
+        full.insert(64, 64);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueFullException&) {
+    }
+    try {
+        Q.merge(full);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueFullException&) {
+    }
+    assert(full == backup && full.size() == 64 && Q.size() == 40);
+
+    Q.merge(R);
+    reference.merge(referenceR);
+    assert(R.empty() && Q.size() == 60);
+    assert(Q.eraseKey(7) == reference.eraseKey(7));
+    while (!reference.empty()) {
+        assert(Q.minValue() == reference.minValue());
+        assert(Q.maxValue() == reference.maxValue());
+        Q.deleteMin();
+        reference.deleteMin();
+    }
+    assert(Q.empty());
+}
+
+void testExternal() {
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "pq_external_test";
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::pair<int, int> > expected;
+    {
+        ExternalPriorityQueue<int, int> P(directory.string(), 64, 8, 4);
+        assert(P.empty());
+        try {
+            P.minValue();
+            assert(!"did not throw");
+        }
+        catch (PriorityQueueEmptyException&) {
+        }
+
+        for (int i = 0; i < 5000; i++) {
+            int value = twister() % 1000;
+            P.insert(i, value);
+            expected.push_back(std::make_pair(value, i));
+            if (i % 7 == 0) {
+                // interleave draining with filling
+                std::sort(expected.begin(), expected.end());
+                assert(P.minValue() == expected.front().first);
+                assert(P.minKey() == expected.front().second);
+                P.deleteMin();
+                expected.erase(expected.begin());
+            }
+        }
+        for (int i = 0; i < 100; i++) {
+            P.insert(-i, 7);
+            expected.push_back(std::make_pair(7, -i));
+        }
+        assert(P.size() == expected.size());
+        // about 150 spills of 32 pairs: levels 0 to 3, at most 3 runs each
+        assert(P.runCount() > 0 && P.runCount() <= 12);
+        assert(!std::filesystem::is_empty(directory));
+
+        std::sort(expected.begin(), expected.end());
+        for (size_t i = 0; i < expected.size() / 2; i++) {
+            assert(P.minValue() == expected[i].first);
+            assert(P.minKey() == expected[i].second);
+            P.deleteMin();
+        }
+        assert(P.size() == expected.size() - expected.size() / 2);
+    }
+    // remaining runs are removed together with the queue
+    assert(std::filesystem::is_empty(directory));
+
+    {
+        ExternalPriorityQueue<int, int> P(directory.string(), 4, 2, 2);
+        for (int i = 0; i < 100; i++)
+            P.insert(i, 1);
+        for (int i = 0; i < 100; i++) {
+            assert(P.minKey() == i);
+            P.deleteMin();
+        }
+        assert(P.empty());
+        P.deleteMin();
+        assert(P.empty());
+    }
+    assert(std::filesystem::is_empty(directory));
+
+    {
+        // a long plateau of equal values still spills half the head
+        ExternalPriorityQueue<int, int> P(directory.string(), 64, 8, 4);
+        for (int i = 0; i < 2000; i++)
+            P.insert(i, i < 1000 ? 5 : 1000 + i % 10);
+        assert(P.runCount() <= 12);
+        for (int i = 0; i < 1000; i++) {
+            assert(P.minValue() == 5 && P.minKey() == i);
+            P.deleteMin();
+        }
+        assert(P.minValue() == 1000);
+    }
+    assert(std::filesystem::is_empty(directory));
+
+    ExternalPriorityQueue<int, int> Q((directory / "missing").string(),
+                                      2, 1, 2);
+    Q.insert(1, 1);
+    Q.insert(2, 2);
+    try {
+        Q.insert(3, 3);
+        assert(!"did not throw");
+    }
+    catch (PriorityQueueIOException&) {
+    }
+    assert(Q.size() == 2 && Q.minKey() == 1);
+    std::filesystem::remove_all(directory);
+}
+
 struct RandomThrower {
     RandomThrower() : id(twister()) { }
     RandomThrower(const RandomThrower& p) : id(p.id) {
@@ -478,8 +1187,18 @@ int main() {
     testCopy();
     std::cout << "after copy" << std::endl;
     testCompare();
-    testRandom();
     testWeirdThings();
+    testErase();
+    testIterators();
+    testSnapshot();
+    testExternal();
+    testTimingWheel();
+    testStatic();
+    testAllocator();
+#ifdef PRIORITYQUEUE_STATS
+    testStats();
+#endif
+    testRandom();
     testOutOfMemory1();
 
     std::cout << "COOOOOL!" << std::endl;
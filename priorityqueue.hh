@@ -1,10 +1,37 @@
 #ifndef PRIORITYQUEUE_HH_
 #define PRIORITYQUEUE_HH_
 
+/* Needs C++14: the sets are searched by a bare key or value (boundK, boundV)
+ * through transparent comparators, which C++11 does not have. std::ranges
+ * support needs C++20 and PmrPriorityQueue C++17; below that they are left
+ * out. */
+#if __cplusplus < 201402L && !defined(_MSVC_LANG)
+#error "priorityqueue.hh needs C++14 or newer"
+#endif
+
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include <memory>
 #include <set>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <type_traits>
 #include <exception>
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
 
 class PriorityQueueEmptyException : public std::exception {
     public:
@@ -20,7 +47,175 @@ class PriorityQueueNotFoundException : public std::exception {
         }
 };
 
-template<typename K, typename V>
+class PriorityQueueIOException : public std::exception {
+    public:
+        virtual const char* what() const throw() {
+            return "PriorityQueue I/O exception";
+        }
+};
+
+/* How keys and values are written by save() and read back by load().
+ * Trivially copyable types are stored as their raw bytes (so snapshots are
+ * only portable between machines of the same byte order); specialize this
+ * template to store anything else. */
+template<typename T, typename Enable = void>
+struct PriorityQueueSerializer;
+
+template<typename T>
+struct PriorityQueueSerializer<T,
+    typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+
+    static void write(std::ostream& out, const T& t) {
+        out.write(reinterpret_cast<const char*>(&t), sizeof(T));
+    }
+
+    static T read(std::istream& in) {
+        T t;
+        if (!in.read(reinterpret_cast<char*>(&t), sizeof(T)))
+            throw PriorityQueueIOException();
+        return t;
+    }
+};
+
+#ifdef PRIORITYQUEUE_STATS
+/* Counters collected when compiled with -DPRIORITYQUEUE_STATS; without it
+ * neither this struct nor any of the counting exists. Every queue has its
+ * own set (some 6 KiB), see PriorityQueue::stats(); it stays with the queue when the
+ * contents are swapped or moved, and a copy starts from zero.
+ *
+ * All the work done while a method of a queue runs in some thread is
+ * counted for that queue: comparisons, pairs allocated and freed (a pair
+ * shared by merge() is freed by whichever queue drops it last), and the
+ * copies other methods make internally - operator= and merge() are
+ * recorded once, as themselves, not as a copy too. Only the outermost
+ * method counts, so a queue used inside another queue's comparisons works
+ * for the outer one; that includes destroying a queue, so one destroyed
+ * inside another queue's method has its pairs freed on the outer queue's
+ * account. Iterating does not count.
+ *
+ * The counters are plain integers, and const methods write them too: in a
+ * stats build even concurrent readers of one queue race, so profile a queue
+ * from one thread at a time. */
+struct PriorityQueueStats {
+    enum method {
+        INSERT, MIN_VALUE, MAX_VALUE, MIN_KEY, MAX_KEY, DELETE_MIN,
+        DELETE_MAX, CHANGE_VALUE, MERGE, ERASE_KEY, ERASE_VALUES_BELOW,
+        ERASE_VALUES_ABOVE, ERASE, COUNT_IN_VALUE_RANGE, COUNT_KEY, COPY,
+        ASSIGN, COMPARE, SAVE, LOAD, DESTROY, METHODS
+    };
+
+    /* latency[m][b] counts calls of m that took [2^b, 2^(b+1)) ns */
+    static const size_t LATENCY_BUCKETS = 40;
+
+    uint64_t comparisons;   // compareVK / compareKV invocations
+    uint64_t allocations;   // pairs allocated
+    uint64_t frees;         // pairs freed
+    uint64_t peakSize;
+    uint64_t calls[METHODS];
+    uint64_t descents[METHODS]; // searches from the root of either set
+    uint64_t latency[METHODS][LATENCY_BUCKETS];
+
+    PriorityQueueStats() {
+        reset();
+    }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    /* counters of the outermost queue method running in this thread */
+    static PriorityQueueStats*& active() {
+        static thread_local PriorityQueueStats* current = nullptr;
+        return current;
+    }
+
+    /* the method those counters are for, valid while active() is set */
+    static method& activeMethod() {
+        static thread_local method current = METHODS;
+        return current;
+    }
+
+    static PriorityQueueStats& activeOr(PriorityQueueStats& own) {
+        return active() ? *active() : own;
+    }
+
+    static const char* methodName(method m) {
+        static const char* const names[METHODS] = {
+            "insert", "minValue", "maxValue", "minKey", "maxKey",
+            "deleteMin", "deleteMax", "changeValue", "merge", "eraseKey",
+            "eraseValuesBelow", "eraseValuesAbove", "erase", "countInValueRange",
+            "countKey", "copy", "operator=", "operator<", "save", "load",
+            "~PriorityQueue"
+        };
+        return names[m];
+    }
+};
+
+/* adds the lifetime of the enclosing scope to the histogram of `m` and makes
+ * `stats` the active counters meanwhile - unless some other queue method is
+ * already running in this thread, then it does nothing */
+class PriorityQueueStatsTimer {
+    public:
+        PriorityQueueStatsTimer(PriorityQueueStats& stats,
+                                PriorityQueueStats::method m)
+            : stats(stats), m(m),
+              outermost(PriorityQueueStats::active() == nullptr),
+              start(std::chrono::steady_clock::now()) {
+            if (outermost) {
+                PriorityQueueStats::active() = &stats;
+                PriorityQueueStats::activeMethod() = m;
+            }
+        }
+
+        PriorityQueueStatsTimer(const PriorityQueueStatsTimer&) = delete;
+        PriorityQueueStatsTimer& operator=(
+            const PriorityQueueStatsTimer&) = delete;
+
+        ~PriorityQueueStatsTimer() {
+            if (!outermost)
+                return;
+            PriorityQueueStats::active() = nullptr;
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            size_t bucket = 0;
+            while (ns > 1 && bucket + 1 < PriorityQueueStats::LATENCY_BUCKETS) {
+                ns >>= 1;
+                ++bucket;
+            }
+            ++stats.calls[m];
+            ++stats.latency[m][bucket];
+        }
+
+    private:
+        PriorityQueueStats& stats;
+        PriorityQueueStats::method m;
+        bool outermost;
+        std::chrono::steady_clock::time_point start;
+};
+
+#define PRIORITYQUEUE_COUNT(counter) do { \
+        if (PriorityQueueStats* active_ = PriorityQueueStats::active()) \
+            ++active_->counter; \
+    } while (0)
+#define PRIORITYQUEUE_DESCENT() do { \
+        if (PriorityQueueStats* active_ = PriorityQueueStats::active()) \
+            ++active_->descents[PriorityQueueStats::activeMethod()]; \
+    } while (0)
+#define PRIORITYQUEUE_TIME(m) PriorityQueueStatsTimer priorityqueue_timer_( \
+    queueStats, PriorityQueueStats::m)
+#define PRIORITYQUEUE_PEAK(n) do { \
+        PriorityQueueStats& peak_ = PriorityQueueStats::activeOr(queueStats); \
+        peak_.peakSize = std::max<uint64_t>(peak_.peakSize, (n)); \
+    } while (0)
+#else
+#define PRIORITYQUEUE_COUNT(counter)
+#define PRIORITYQUEUE_DESCENT()
+#define PRIORITYQUEUE_TIME(m)
+#define PRIORITYQUEUE_PEAK(n)
+#endif
+
+template<typename K, typename V,
+         typename A = std::allocator<std::pair<const K, V> > >
 class PriorityQueue {
 
     public:
@@ -28,13 +223,19 @@ class PriorityQueue {
         typedef size_t size_type;
         typedef K key_type;
         typedef V value_type;
+        typedef A allocator_type;
 
         PriorityQueue();
-        PriorityQueue(const PriorityQueue<K, V>& queue);
-        PriorityQueue(PriorityQueue<K, V>&& queue);
-        PriorityQueue<K, V>& operator=(PriorityQueue<K, V> &queue);
-        PriorityQueue<K, V>& operator=(PriorityQueue<K, V> &&queue);
-        void swap(PriorityQueue<K, V>& queue);
+        explicit PriorityQueue(const A& allocator);
+        PriorityQueue(const PriorityQueue<K, V, A>& queue);
+        PriorityQueue(const PriorityQueue<K, V, A>& queue, const A& allocator);
+        PriorityQueue(PriorityQueue<K, V, A>&& queue);
+#ifdef PRIORITYQUEUE_STATS
+        ~PriorityQueue();
+#endif
+        PriorityQueue<K, V, A>& operator=(PriorityQueue<K, V, A> &queue);
+        PriorityQueue<K, V, A>& operator=(PriorityQueue<K, V, A> &&queue);
+        void swap(PriorityQueue<K, V, A>& queue);
         const V& minValue() const;
         const V& maxValue() const;
         const K& minKey() const;
@@ -42,31 +243,163 @@ class PriorityQueue {
         void deleteMin();
         void deleteMax();
         void changeValue(const K& key, const V& value);
-        void merge(PriorityQueue<K, V>& queue);
-        bool operator<(const PriorityQueue<K, V>& other) const;
+        void merge(PriorityQueue<K, V, A>& queue);
+        bool operator<(const PriorityQueue<K, V, A>& other) const;
 
         bool empty() const;
         size_type size() const;
         void insert(const K& key, const V& value);
 
-    private:
-        void deleteKey(const K& k);
-        typedef struct pairKV {
+        size_type eraseKey(const K& key);
+        size_type eraseValuesBelow(const V& value);
+        size_type eraseValuesAbove(const V& value);
+        size_type countInValueRange(const V& low, const V& high) const;
+        size_type countKey(const K& key) const;
+
+        A get_allocator() const;
+
+        void save(const std::string& path) const;
+        void load(const std::string& path);
+
+#ifdef PRIORITYQUEUE_STATS
+        PriorityQueueStats& stats() const;
+#endif
+
+        /* what the iterators point at - the pair as stored in the queue */
+        struct entryKV {
             K key;
             V val;
 
-            pairKV(const pairKV& pKV) {
-                key(pKV.key);
-                val(pKV.val);
+            entryKV(const K& k, const V& v) : key(k) , val(v) {
             }
+        };
 
-            pairKV(const K& k, const V& v) : key(k) , val(v) {
-            }
-        } pairKV;
+        /* read-only view of one of the sets; dereferences straight to the
+         * stored pair, so iterating neither copies nor allocates */
+        template<typename SetIterator>
+        class entryIterator {
+            public:
+                typedef std::bidirectional_iterator_tag iterator_category;
+                typedef entryKV value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const entryKV* pointer;
+                typedef const entryKV& reference;
+
+                entryIterator() : it() {
+                }
+
+                explicit entryIterator(SetIterator it) : it(it) {
+                }
+
+                reference operator*() const {
+                    return **it;
+                }
+
+                pointer operator->() const {
+                    return it->get();
+                }
+
+                entryIterator& operator++() {
+                    ++it;
+                    return *this;
+                }
+
+                entryIterator operator++(int) {
+                    entryIterator old(*this);
+                    ++it;
+                    return old;
+                }
+
+                entryIterator& operator--() {
+                    --it;
+                    return *this;
+                }
+
+                entryIterator operator--(int) {
+                    entryIterator old(*this);
+                    --it;
+                    return old;
+                }
+
+                bool operator==(const entryIterator& other) const {
+                    return it == other.it;
+                }
+
+                bool operator!=(const entryIterator& other) const {
+                    return it != other.it;
+                }
+
+                /* the iterator of the set underneath */
+                SetIterator base() const {
+                    return it;
+                }
+
+            private:
+                SetIterator it;
+        };
+
+        /* [begin, end) pair usable in range-for; a view under C++20 */
+        template<typename Iterator>
+        class entryRange
+#if __cplusplus >= 202002L
+            : public std::ranges::view_base
+#endif
+        {
+            public:
+                entryRange() : first(), last() {
+                }
+
+                entryRange(Iterator first, Iterator last)
+                    : first(first), last(last) {
+                }
+
+                Iterator begin() const {
+                    return first;
+                }
+
+                Iterator end() const {
+                    return last;
+                }
+
+                bool empty() const {
+                    return first == last;
+                }
+
+            private:
+                Iterator first;
+                Iterator last;
+        };
+
+    private:
+        struct pairKV;
+
+        /* bare value / key used for heterogeneous lookups in the sets */
+        struct boundV {
+            const V& val;
+        };
+
+        struct boundK {
+            const K& key;
+        };
 
         struct compareVK {
+            typedef void is_transparent;
+
             bool operator() (const std::shared_ptr<pairKV>& lhs,
+            const boundV& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
+                return lhs->val < rhs.val;
+            }
+
+            bool operator() (const boundV& lhs,
             const std::shared_ptr<pairKV>& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
+                return lhs.val < rhs->val;
+            }
+
+            bool operator() (const std::shared_ptr<pairKV>& lhs,
+            const std::shared_ptr<pairKV>& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
                 if (lhs->val < rhs->val)
                     return true;
                 else if (rhs->val < lhs->val)
@@ -81,8 +414,23 @@ class PriorityQueue {
         };
 
         struct compareKV {
+            typedef void is_transparent;
+
+            bool operator() (const std::shared_ptr<pairKV>& lhs,
+            const boundK& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
+                return lhs->key < rhs.key;
+            }
+
+            bool operator() (const boundK& lhs,
+            const std::shared_ptr<pairKV>& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
+                return lhs.key < rhs->key;
+            }
+
             bool operator() (const std::shared_ptr<pairKV>& lhs,
             const std::shared_ptr<pairKV>& rhs) const {
+                PRIORITYQUEUE_COUNT(comparisons);
                 if (lhs->key < rhs->key)
                     return true;
                 else if (rhs->key < lhs->key)
@@ -94,96 +442,302 @@ class PriorityQueue {
                 return false;
             }
         };
-        std::multiset<std::shared_ptr<pairKV>, compareVK> sortedSetVK;
-        std::multiset<std::shared_ptr<pairKV>, compareKV> sortedSetKV;
 
+        typedef typename std::allocator_traits<A>::template
+            rebind_alloc<pairKV> pair_allocator;
+        typedef typename std::allocator_traits<A>::template
+            rebind_alloc<std::shared_ptr<pairKV> > node_allocator;
+        typedef std::multiset<std::shared_ptr<pairKV>, compareVK,
+                              node_allocator> setVK;
+        typedef std::multiset<std::shared_ptr<pairKV>, compareKV,
+                              node_allocator> setKV;
+
+        /* every pair remembers where it sits in both sets, so removing it
+         * from the other set needs no lookup (and no comparison) */
+        struct pairKV : public entryKV {
+            typename setVK::iterator posVK;
+            typename setKV::iterator posKV;
+
+            pairKV(const K& k, const V& v) : entryKV(k, v) {
+                PRIORITYQUEUE_COUNT(allocations);
+            }
+
+#ifdef PRIORITYQUEUE_STATS
+            ~pairKV() {
+                PRIORITYQUEUE_COUNT(frees);
+            }
+#endif
+        };
+
+        static typename setVK::iterator& position(pairKV& p, setVK&) {
+            return p.posVK;
+        }
 
+        static typename setKV::iterator& position(pairKV& p, setKV&) {
+            return p.posKV;
+        }
+
+        std::shared_ptr<pairKV> makePair(const K& key, const V& value) const;
+        void relink();
+
+        /* Snapshot layout (native byte order): this header, followed by
+         * the payload - key, value, key, value, ... as written by
+         * PriorityQueueSerializer, in the order of (value, key). */
+        struct snapshotHeader {
+            char magic[8];        // "PQSNAP\0\0"
+            uint32_t version;
+            uint32_t reserved;    // 0
+            uint64_t count;       // number of pairs
+            uint64_t length;      // payload length in bytes
+            uint64_t checksum;    // FNV-1a of the payload
+        };
+
+        static const uint32_t SNAPSHOT_VERSION = 1;
+
+        static const char* snapshotMagic() {
+            return "PQSNAP\0";
+        }
+
+        static const uint64_t CHECKSUM_BASIS = 14695981039346656037ULL;
+
+        /* passes what the serializers write on to the file, or at most
+         * `limit` bytes of the file on to the serializers, hashing and
+         * counting it on the way */
+        struct checksumBuffer : public std::streambuf {
+            explicit checksumBuffer(std::streambuf* target,
+                                    uint64_t limit = 0)
+                : target(target), hash(CHECKSUM_BASIS), length(0),
+                  left(limit), block(limit ? 1 << 16 : 0) {
+            }
+
+            int_type underflow() {
+                if (gptr() < egptr())
+                    return traits_type::to_int_type(*gptr());
+                std::streamsize chunk = static_cast<std::streamsize>(
+                    std::min<uint64_t>(left, block.size()));
+                std::streamsize got =
+                    chunk > 0 ? target->sgetn(block.data(), chunk) : 0;
+                if (got <= 0)
+                    return traits_type::eof();
+                hash = checksum(block.data(), got, hash);
+                length += got;
+                left -= got;
+                setg(block.data(), block.data(), block.data() + got);
+                return traits_type::to_int_type(*gptr());
+            }
+
+            /* all of the limit has been read and handed on */
+            bool drained() const {
+                return left == 0 && gptr() == egptr();
+            }
+
+            int overflow(int c) {
+                if (traits_type::eq_int_type(c, traits_type::eof()))
+                    return traits_type::not_eof(c);
+                char ch = traits_type::to_char_type(c);
+                hash = checksum(&ch, 1, hash);
+                ++length;
+                return target->sputc(ch);
+            }
+
+            std::streamsize xsputn(const char* s, std::streamsize n) {
+                hash = checksum(s, n, hash);
+                length += n;
+                return target->sputn(s, n);
+            }
+
+            std::streambuf* target;
+            uint64_t hash;
+            uint64_t length;
+            uint64_t left;
+            std::vector<char> block;
+        };
+
+        static uint64_t checksum(const char* data, size_t length,
+                                 uint64_t hash = CHECKSUM_BASIS);
+        static std::string temporaryPath(const std::string& path,
+                                         const void* owner);
+        template<typename DriveSet, typename OtherSet>
+        static size_type eraseRange(DriveSet& drive,
+            typename DriveSet::const_iterator first,
+            typename DriveSet::const_iterator last,
+            OtherSet& other);
+
+        setVK sortedSetVK;
+        setKV sortedSetKV;
+#ifdef PRIORITYQUEUE_STATS
+        mutable PriorityQueueStats queueStats;
+#endif
+
+    public:
+        typedef entryKV entry_type;
+        /* pairs in the order of (value, key) */
+        typedef entryIterator<typename setVK::const_iterator> const_iterator;
+        /* pairs in the order of (key, value) */
+        typedef entryIterator<typename setKV::const_iterator>
+            const_key_iterator;
+        typedef entryRange<const_iterator> value_range;
+        typedef entryRange<const_key_iterator> key_range;
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        const_key_iterator beginByKey() const;
+        const_key_iterator endByKey() const;
+        value_range byValue() const;
+        key_range byKey() const;
+        key_range equal_range(const K& key) const;
+        size_type erase(const_iterator first, const_iterator last);
 };
 
 /******************** Constructors ********************/
 
 /* default constructor */
-template<typename K, typename V>
-PriorityQueue<K, V>::PriorityQueue() {
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::PriorityQueue() {
+}
+
+/* Pairs and set nodes are all allocated with (a rebound copy of) allocator,
+ * e.g. a std::pmr::polymorphic_allocator over a per-request arena. */
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::PriorityQueue(const A& allocator)
+    : sortedSetVK(compareVK(), node_allocator(allocator)),
+      sortedSetKV(compareKV(), node_allocator(allocator)) {
+}
+
+/* the copy gets the allocator the standard containers would give it */
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::PriorityQueue(const PriorityQueue<K, V, A>& queue)
+    : PriorityQueue(queue, std::allocator_traits<A>::
+          select_on_container_copy_construction(queue.get_allocator())) {
 }
 
 /* copy constructor of map and set has strong exception guarantee */
-template<typename K, typename V>
-PriorityQueue<K, V>::PriorityQueue(const PriorityQueue<K, V>& queue) {
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::PriorityQueue(const PriorityQueue<K, V, A>& queue,
+                                      const A& allocator)
+    : PriorityQueue(allocator) {
+  PRIORITYQUEUE_TIME(COPY);
   for (auto iterator = queue.sortedSetVK.begin();
       iterator != queue.sortedSetVK.end();
       ++iterator) {
-    auto temporary_pointer = std::make_shared<pairKV>(
-        (*iterator)->key, (*iterator)->val);
-    sortedSetVK.insert(sortedSetVK.end(), temporary_pointer);
-    sortedSetKV.insert(temporary_pointer);
+    auto temporary_pointer = makePair((*iterator)->key, (*iterator)->val);
+    temporary_pointer->posVK =
+        sortedSetVK.insert(sortedSetVK.end(), temporary_pointer);
+    PRIORITYQUEUE_DESCENT();
+    temporary_pointer->posKV = sortedSetKV.insert(temporary_pointer);
   }
+  PRIORITYQUEUE_PEAK(size());
 }
 
-/* move constructor - just swap our empty multisets for the passed queue's
- * multiset ... */
-template<typename K, typename V>
-PriorityQueue<K, V>::PriorityQueue(PriorityQueue<K, V>&& queue) {
+/* move constructor - just swap our empty multisets (using the same
+ * allocator) for the passed queue's multiset ... */
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::PriorityQueue(PriorityQueue<K, V, A>&& queue)
+    : PriorityQueue(queue.get_allocator()) {
     queue.sortedSetVK.swap(sortedSetVK);
     queue.sortedSetKV.swap(sortedSetKV);
 
 }
 
+#ifdef PRIORITYQUEUE_STATS
+/* the pairs are freed while the counters of this queue are active, unless
+ * some queue method is running already - then they count for that one */
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>::~PriorityQueue() {
+    PriorityQueueStats*& active = PriorityQueueStats::active();
+    PriorityQueueStats* outer = active;
+    if (outer == nullptr) {
+        active = &queueStats;
+        PriorityQueueStats::activeMethod() = PriorityQueueStats::DESTROY;
+    }
+    sortedSetKV.clear();
+    sortedSetVK.clear();
+    active = outer;
+}
+#endif
+
 /* move assignment operator=(mainly for temporary objects being passed as a
  * parameter) */
-/* COMPLEXITY : O(1) : obvious - swap. */
-template<typename K, typename V>
-PriorityQueue<K, V>& PriorityQueue<K, V>::operator=(PriorityQueue<K, V> &&queue) {
+/* COMPLEXITY : O(1) : obvious - swap. O(size(queue)) if the allocators
+ * differ, as the pairs then have to be copied into our own memory. */
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>& PriorityQueue<K, V, A>::operator=(PriorityQueue<K, V, A> &&queue) {
     if (this != &queue) {
-        queue.sortedSetVK.swap(sortedSetVK);
-        queue.sortedSetKV.swap(sortedSetKV);
+        if (get_allocator() == queue.get_allocator()) {
+            queue.sortedSetVK.swap(sortedSetVK);
+            queue.sortedSetKV.swap(sortedSetKV);
+        } else {
+            PriorityQueue<K, V, A> new_one(queue, get_allocator());
+            this->swap(new_one);
+        }
     }
     return *this;
 }
 
 /* assignment operator= for lvalues ... we just copy the multisets ... */
 /* COMPLEXITY : O(size(queue)) : from stl::set) */
-template<typename K, typename V>
-PriorityQueue<K, V>& PriorityQueue<K, V>::operator=(PriorityQueue<K, V> &queue) {
+template<typename K, typename V, typename A>
+PriorityQueue<K, V, A>& PriorityQueue<K, V, A>::operator=(PriorityQueue<K, V, A> &queue) {
+    PRIORITYQUEUE_TIME(ASSIGN);
 
     if (this != &queue) {
-        PriorityQueue<K, V> new_one(queue);
+        PriorityQueue<K, V, A> new_one(queue, get_allocator());
         this->swap(new_one);
     }
     return *this;
 }
 
 /* COMPLEXITY : O(1) : from stl::set */
-template<typename K, typename V>
-bool PriorityQueue<K, V>::empty() const {
+template<typename K, typename V, typename A>
+bool PriorityQueue<K, V, A>::empty() const {
     return sortedSetVK.empty();
 }
 
+/* COMPLEXITY : O(1) */
+template<typename K, typename V, typename A>
+A PriorityQueue<K, V, A>::get_allocator() const {
+    return A(sortedSetVK.get_allocator());
+}
+
+/* COMPLEXITY : O(1) */
+template<typename K, typename V, typename A>
+std::shared_ptr<typename PriorityQueue<K, V, A>::pairKV>
+PriorityQueue<K, V, A>::makePair(const K& key, const V& value) const {
+    return std::allocate_shared<pairKV>(
+        pair_allocator(sortedSetVK.get_allocator()), key, value);
+}
+
 /* 1!) typename keyword added */
 /* COMPLEXITY : O(1) : from stl::set */
-template<typename K, typename V>
-typename PriorityQueue<K, V>::size_type PriorityQueue<K, V>::size() const {
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::size() const {
     return sortedSetVK.size();
 }
 
 /* COMPLEXITY : O(log(size(this))) : */
-template<typename K, typename V>
-void PriorityQueue<K, V>::insert(const K& key, const V& value) {
-    auto ptr = std::make_shared<pairKV>(key, value);
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::insert(const K& key, const V& value) {
+    PRIORITYQUEUE_TIME(INSERT);
+    auto ptr = makePair(key, value);
+    PRIORITYQUEUE_DESCENT();
     auto helper_iterator = sortedSetVK.lower_bound(ptr);
-    sortedSetVK.insert(helper_iterator, ptr);
+    helper_iterator = sortedSetVK.insert(helper_iterator, ptr);
     try {
+      PRIORITYQUEUE_DESCENT();
       auto helper_iterator_2 = sortedSetKV.lower_bound(ptr);
-      sortedSetKV.insert(helper_iterator_2, ptr);
+      ptr->posKV = sortedSetKV.insert(helper_iterator_2, ptr);
     } catch (...) {
       sortedSetVK.erase(helper_iterator);
       throw;
     }
+    ptr->posVK = helper_iterator;
+    PRIORITYQUEUE_PEAK(size());
 }
 
 /* COMPLEXITY - O(1) */
-template<typename K, typename V>
-const V& PriorityQueue<K, V>::minValue() const {
+template<typename K, typename V, typename A>
+const V& PriorityQueue<K, V, A>::minValue() const {
+    PRIORITYQUEUE_TIME(MIN_VALUE);
     if (sortedSetVK.empty()) {
         throw PriorityQueueEmptyException();
     }
@@ -191,8 +745,9 @@ const V& PriorityQueue<K, V>::minValue() const {
 }
 
 /* COMPLEXITY - O(1) */
-template<typename K, typename V>
-const V& PriorityQueue<K, V>::maxValue() const {
+template<typename K, typename V, typename A>
+const V& PriorityQueue<K, V, A>::maxValue() const {
+    PRIORITYQUEUE_TIME(MAX_VALUE);
     if (sortedSetVK.empty()) {
         throw PriorityQueueEmptyException();
     }
@@ -200,8 +755,9 @@ const V& PriorityQueue<K, V>::maxValue() const {
 }
 
 /* COMPLEXITY - O(1) */
-template<typename K, typename V>
-const K& PriorityQueue<K, V>::minKey() const {
+template<typename K, typename V, typename A>
+const K& PriorityQueue<K, V, A>::minKey() const {
+    PRIORITYQUEUE_TIME(MIN_KEY);
     if (sortedSetVK.empty()) {
         throw PriorityQueueEmptyException();
     }
@@ -209,8 +765,9 @@ const K& PriorityQueue<K, V>::minKey() const {
 }
 
 /* COMPLEXITY - O(1) */
-template<typename K, typename V>
-const K& PriorityQueue<K, V>::maxKey() const {
+template<typename K, typename V, typename A>
+const K& PriorityQueue<K, V, A>::maxKey() const {
+    PRIORITYQUEUE_TIME(MAX_KEY);
     if (sortedSetVK.empty()) {
         throw PriorityQueueEmptyException();
     }
@@ -218,92 +775,389 @@ const K& PriorityQueue<K, V>::maxKey() const {
 }
 
 /* COMPLEXITY - O(log(size(this))) */
-template<typename K, typename V>
-void PriorityQueue<K, V>::deleteMin() {
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::deleteMin() {
+    PRIORITYQUEUE_TIME(DELETE_MIN);
     if (sortedSetVK.empty())
         return;
     auto itVK = sortedSetVK.begin();
-    auto itKV = sortedSetKV.find(*itVK);
+    sortedSetKV.erase((*itVK)->posKV);
     sortedSetVK.erase(itVK);
-    sortedSetKV.erase(itKV);
 }
 
 /* COMPLEXITY - O(log(size(this))) */
-template<typename K, typename V>
-void PriorityQueue<K, V>::deleteMax() {
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::deleteMax() {
+    PRIORITYQUEUE_TIME(DELETE_MAX);
     if (sortedSetVK.empty())
         return;
     auto itVK = sortedSetVK.end();
     --itVK;
-    auto itKV = sortedSetKV.find(*itVK);
+    sortedSetKV.erase((*itVK)->posKV);
     sortedSetVK.erase(itVK);
-    sortedSetKV.erase(itKV);
 }
 
 /* COMPLEXITY - O(log(size(this))) */
-template<typename K, typename V>
-void PriorityQueue<K, V>::changeValue(const K& key, const V& value) {
-    std::shared_ptr<pairKV> ptr =
-        std::make_shared<pairKV>(key, value);
-
-    auto it = sortedSetKV.lower_bound(ptr);
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::changeValue(const K& key, const V& value) {
+    PRIORITYQUEUE_TIME(CHANGE_VALUE);
+    PRIORITYQUEUE_DESCENT();
+    auto it = sortedSetKV.lower_bound(boundK{key});
 
-    if (this->empty() ||
-        !((it != sortedSetKV.end() && (*it)->key == key) ||
-          (it != sortedSetKV.begin() && (*(--it))->key == key))) {
+    if (it == sortedSetKV.end() || key < (*it)->key) {
       throw PriorityQueueNotFoundException();
     }
 
     auto temp_ptr = *it;
+    auto ptr = makePair(key, value);
 
-    auto helper_insert_it_1 = sortedSetKV.lower_bound(ptr);
-    auto helper_insert_it_2 = sortedSetVK.lower_bound(ptr);
-
-    helper_insert_it_1 = sortedSetKV.insert(helper_insert_it_1, ptr);
-    helper_insert_it_2 = sortedSetVK.insert(helper_insert_it_2, ptr);
+    PRIORITYQUEUE_DESCENT();
+    auto helper_insert_it_1 = sortedSetVK.lower_bound(ptr);
+    helper_insert_it_1 = sortedSetVK.insert(helper_insert_it_1, ptr);
 
     try {
+      PRIORITYQUEUE_DESCENT();
+      auto helper_insert_it_2 = sortedSetKV.lower_bound(ptr);
+      ptr->posKV = sortedSetKV.insert(helper_insert_it_2, ptr);
+    } catch (...) {
+      sortedSetVK.erase(helper_insert_it_1);
+      throw;
+    }
+    ptr->posVK = helper_insert_it_1;
+
+    sortedSetKV.erase(temp_ptr->posKV);
+    sortedSetVK.erase(temp_ptr->posVK);
+}
 
-      auto helper_erase_it_1 = sortedSetKV.lower_bound(temp_ptr);
-      auto helper_erase_it_2 = sortedSetVK.lower_bound(temp_ptr);
+/* points every pair back at its nodes, after the sets were (re)built */
+/* COMPLEXITY - O(size(this)) */
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::relink() {
+    for (auto it = sortedSetVK.begin(); it != sortedSetVK.end(); ++it)
+        (*it)->posVK = it;
+    for (auto it = sortedSetKV.begin(); it != sortedSetKV.end(); ++it)
+        (*it)->posKV = it;
+}
 
-      sortedSetKV.erase(helper_erase_it_1);
-      sortedSetVK.erase(helper_erase_it_2);
+/* Removes the pairs [first, last) of `drive` from both sets. The pairs know
+ * their nodes in `other`, so nothing here compares or allocates - it cannot
+ * throw and no pair is looked up twice. */
+/* COMPLEXITY - O(k) amortized, k = |[first, last)| */
+template<typename K, typename V, typename A>
+template<typename DriveSet, typename OtherSet>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::eraseRange(
+    DriveSet& drive,
+    typename DriveSet::const_iterator first,
+    typename DriveSet::const_iterator last,
+    OtherSet& other) {
+    size_type k = 0;
+    for (auto it = first; it != last; ++it, ++k)
+        other.erase(position(**it, other));
+    drive.erase(first, last);
+    return k;
+}
 
-    } catch (...) {
+/* COMPLEXITY - O(log(size(this)) + countKey(key)) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::eraseKey(
+    const K& key) {
+    PRIORITYQUEUE_TIME(ERASE_KEY);
+    PRIORITYQUEUE_DESCENT();
+    auto range = sortedSetKV.equal_range(boundK{key});
+    return eraseRange(sortedSetKV, range.first, range.second, sortedSetVK);
+}
 
-      sortedSetKV.erase(helper_insert_it_1);
-      sortedSetVK.erase(helper_insert_it_2);
+/* erases every pair whose value is strictly less than `value` */
+/* COMPLEXITY - O(log(size(this)) + k), k = number of erased pairs */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::eraseValuesBelow(
+    const V& value) {
+    PRIORITYQUEUE_TIME(ERASE_VALUES_BELOW);
+    PRIORITYQUEUE_DESCENT();
+    auto last = sortedSetVK.lower_bound(boundV{value});
+    return eraseRange(sortedSetVK, sortedSetVK.begin(), last, sortedSetKV);
+}
 
-      throw;
+/* erases every pair whose value is strictly greater than `value` */
+/* COMPLEXITY - O(log(size(this)) + k), k = number of erased pairs */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::eraseValuesAbove(
+    const V& value) {
+    PRIORITYQUEUE_TIME(ERASE_VALUES_ABOVE);
+    PRIORITYQUEUE_DESCENT();
+    auto first = sortedSetVK.upper_bound(boundV{value});
+    return eraseRange(sortedSetVK, first, sortedSetVK.end(), sortedSetKV);
+}
+
+/* erases the pairs [first, last) of the (value, key) order, e.g. everything
+ * from the median up; iterators to other pairs stay valid */
+/* COMPLEXITY - O(k) amortized, k = number of erased pairs */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::erase(
+    const_iterator first, const_iterator last) {
+    PRIORITYQUEUE_TIME(ERASE);
+    return eraseRange(sortedSetVK, first.base(), last.base(), sortedSetKV);
+}
+
+/* number of pairs with low <= value <= high */
+/* COMPLEXITY - O(log(size(this)) + result) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::countInValueRange(
+    const V& low, const V& high) const {
+    PRIORITYQUEUE_TIME(COUNT_IN_VALUE_RANGE);
+    if (high < low)
+        return 0;
+    PRIORITYQUEUE_DESCENT(); // lower_bound
+    PRIORITYQUEUE_DESCENT(); // upper_bound
+    return std::distance(sortedSetVK.lower_bound(boundV{low}),
+                         sortedSetVK.upper_bound(boundV{high}));
+}
+
+/* COMPLEXITY - O(log(size(this)) + result) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::size_type PriorityQueue<K, V, A>::countKey(
+    const K& key) const {
+    PRIORITYQUEUE_TIME(COUNT_KEY);
+    PRIORITYQUEUE_DESCENT();
+    return sortedSetKV.count(boundK{key});
+}
+
+#ifdef PRIORITYQUEUE_STATS
+/* counters of this queue, see PriorityQueueStats */
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+PriorityQueueStats& PriorityQueue<K, V, A>::stats() const {
+    return queueStats;
+}
+#endif
+
+/******************** Snapshots ********************/
+
+/* COMPLEXITY - O(length) */
+template<typename K, typename V, typename A>
+uint64_t PriorityQueue<K, V, A>::checksum(const char* data, size_t length,
+                                          uint64_t hash) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
     }
+    return hash;
 }
 
+/* next to path, so that rename() does not cross file systems; unique
+ * between calls and queues by the counter and the queue's address, between
+ * processes by a random number drawn once per process */
+template<typename K, typename V, typename A>
+std::string PriorityQueue<K, V, A>::temporaryPath(const std::string& path,
+                                                  const void* owner) {
+    static const uint64_t process = [] {
+        uint64_t seed = static_cast<uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        try {
+            std::random_device device;
+            seed ^= (uint64_t(device()) << 32) | device();
+        } catch (const std::exception&) {
+            // no entropy source - the clock alone has to do
+        }
+        return seed;
+    }();
+    static std::atomic<unsigned long> counter(0);
+    std::string result = path + ".tmp." + std::to_string(process) + "." +
+        std::to_string(reinterpret_cast<uintptr_t>(owner)) + "." +
+        std::to_string(counter++);
+    return result;
+}
+
+/* Pairs are streamed straight to a temporary file, hashed on the way, and
+ * the header is filled in at the end; the file then replaces path with
+ * rename(). The queue is never modified and a failed save leaves the
+ * previous snapshot at path as it was. */
+/* COMPLEXITY - O(size(this)) */
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::save(const std::string& path) const {
+    PRIORITYQUEUE_TIME(SAVE);
+    const std::string temporary = temporaryPath(path, this);
+    try {
+        std::ofstream out(temporary.c_str(),
+                          std::ios::binary | std::ios::trunc);
+        snapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        checksumBuffer buffer(out.rdbuf());
+        std::ostream payload(&buffer);
+        for (auto it = sortedSetVK.begin(); it != sortedSetVK.end(); ++it) {
+            PriorityQueueSerializer<K>::write(payload, (*it)->key);
+            PriorityQueueSerializer<V>::write(payload, (*it)->val);
+        }
+        if (!payload || !out)
+            throw PriorityQueueIOException();
+
+        memcpy(header.magic, snapshotMagic(), sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.count = size();
+        header.length = buffer.length;
+        header.checksum = buffer.hash;
+        out.seekp(0, std::ios::beg);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out || ::rename(temporary.c_str(), path.c_str()) != 0)
+            throw PriorityQueueIOException();
+    }
+    catch (...) {
+        ::remove(temporary.c_str());
+        throw;
+    }
+}
+
+/* Replaces the contents of the queue with the snapshot (strong guarantee).
+ * The payload is read once, through a checksumBuffer; the pairs are only
+ * swapped in if all of it was parsed and the checksum matches, a corrupted
+ * file just leaves `loaded` to be thrown away. Note that a serializer may
+ * thus see corrupted data, and fail with an exception of its own (e.g.
+ * std::bad_alloc for an absurd string length).
+ *
+ * The payload is already in (value, key) order, so the value index is built
+ * by appending at its end; for the key index the nodes are sorted and
+ * appended the same way. */
+/* COMPLEXITY - O(n log n) comparisons, O(n) set insertions, n = pairs */
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::load(const std::string& path) {
+    PRIORITYQUEUE_TIME(LOAD);
+    std::ifstream in(path.c_str(), std::ios::binary);
+    snapshotHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, snapshotMagic(),
+               sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION) {
+        throw PriorityQueueIOException();
+    }
+
+    in.seekg(0, std::ios::end);
+    if (!in || static_cast<uint64_t>(in.tellg()) !=
+               sizeof(header) + header.length) {
+        throw PriorityQueueIOException();
+    }
+    in.seekg(sizeof(header), std::ios::beg);
+
+    checksumBuffer buffer(in.rdbuf(), header.length);
+    std::istream payload(&buffer);
+    PriorityQueue<K, V, A> loaded(get_allocator());
+    std::vector<typename setVK::iterator> byKey;
+    byKey.reserve(static_cast<size_t>(
+        std::min(header.count, header.length)));
+    for (uint64_t i = 0; i < header.count; ++i) {
+        K key = PriorityQueueSerializer<K>::read(payload);
+        V val = PriorityQueueSerializer<V>::read(payload);
+        byKey.push_back(loaded.sortedSetVK.insert(
+            loaded.sortedSetVK.end(), makePair(key, val)));
+    }
+    if (!buffer.drained() || buffer.hash != header.checksum)
+        throw PriorityQueueIOException();
+
+    std::sort(byKey.begin(), byKey.end(),
+        [](typename setVK::iterator lhs, typename setVK::iterator rhs) {
+            return compareKV()(*lhs, *rhs);
+        });
+    for (auto it = byKey.begin(); it != byKey.end(); ++it)
+        loaded.sortedSetKV.insert(loaded.sortedSetKV.end(), **it);
+    loaded.relink();
+
+    this->swap(loaded);
+    PRIORITYQUEUE_PEAK(size());
+}
+
+/******************** Iteration ********************/
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::const_iterator
+PriorityQueue<K, V, A>::begin() const {
+    return const_iterator(sortedSetVK.begin());
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::const_iterator
+PriorityQueue<K, V, A>::end() const {
+    return const_iterator(sortedSetVK.end());
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::const_key_iterator
+PriorityQueue<K, V, A>::beginByKey() const {
+    return const_key_iterator(sortedSetKV.begin());
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::const_key_iterator
+PriorityQueue<K, V, A>::endByKey() const {
+    return const_key_iterator(sortedSetKV.end());
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::value_range
+PriorityQueue<K, V, A>::byValue() const {
+    return value_range(begin(), end());
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::key_range
+PriorityQueue<K, V, A>::byKey() const {
+    return key_range(beginByKey(), endByKey());
+}
+
+/* all pairs with the given key, ordered by value */
+/* COMPLEXITY - O(log(size(this))) */
+template<typename K, typename V, typename A>
+typename PriorityQueue<K, V, A>::key_range
+PriorityQueue<K, V, A>::equal_range(const K& key) const {
+    PRIORITYQUEUE_DESCENT();
+    auto range = sortedSetKV.equal_range(boundK{key});
+    return key_range(const_key_iterator(range.first),
+                     const_key_iterator(range.second));
+}
+
+/* pairs of a queue with an equal allocator are taken over, otherwise they
+ * are copied into our memory */
 // COMPLEXITY = O(size() + queue.size() * log(size() + queue.size())) 
-template<typename K, typename V>
-void PriorityQueue<K, V>::merge(PriorityQueue<K, V>& queue) {
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::merge(PriorityQueue<K, V, A>& queue) {
+    PRIORITYQUEUE_TIME(MERGE);
     if (queue.empty())
         return;
 
     if (this != &queue) {
-      PriorityQueue<K, V> new_one(*this);
+      PriorityQueue<K, V, A> new_one(*this, get_allocator());
+      bool share = get_allocator() == queue.get_allocator();
 
       for (auto iterator = queue.sortedSetVK.begin();
           iterator != queue.sortedSetVK.end();
           ++iterator) {
 
-        new_one.sortedSetVK.insert(*iterator);
-        new_one.sortedSetKV.insert(*iterator);
+        auto ptr = share ? *iterator
+                         : makePair((*iterator)->key, (*iterator)->val);
+        PRIORITYQUEUE_DESCENT();
+        new_one.sortedSetVK.insert(ptr);
+        PRIORITYQUEUE_DESCENT();
+        new_one.sortedSetKV.insert(ptr);
       }
+      new_one.relink();
 
-      queue = PriorityQueue<K, V>();
+      queue = PriorityQueue<K, V, A>(queue.get_allocator());
       this->swap(new_one); 
+      PRIORITYQUEUE_PEAK(size());
     }
 }
 
+/* like for the standard containers, the allocators have to compare equal */
 // COMPLEXITY = O(1) 
-template<typename K, typename V>
-void PriorityQueue<K, V>::swap(PriorityQueue<K, V>& queue) {
+template<typename K, typename V, typename A>
+void PriorityQueue<K, V, A>::swap(PriorityQueue<K, V, A>& queue) {
     if (this != &queue) {
       std::swap(queue.sortedSetVK, sortedSetVK);
       std::swap(queue.sortedSetKV, sortedSetKV);
@@ -311,14 +1165,15 @@ void PriorityQueue<K, V>::swap(PriorityQueue<K, V>& queue) {
 }
 
 // COMPLEXITY = O(1) 
-template<typename K, typename V>
-void swap(PriorityQueue<K, V>& lp, PriorityQueue<K, V>& rp) {
+template<typename K, typename V, typename A>
+void swap(PriorityQueue<K, V, A>& lp, PriorityQueue<K, V, A>& rp) {
     lp.swap(rp);
 }
 
 // COMPLEXITY = O(size()) 
-template<typename K, typename V>
-bool PriorityQueue<K, V>::operator<(const PriorityQueue<K, V>& rhs) const {
+template<typename K, typename V, typename A>
+bool PriorityQueue<K, V, A>::operator<(const PriorityQueue<K, V, A>& rhs) const {
+    PRIORITYQUEUE_TIME(COMPARE);
 
     auto it = sortedSetKV.begin();
     auto it_rhs = rhs.sortedSetKV.begin();
@@ -344,34 +1199,41 @@ bool PriorityQueue<K, V>::operator<(const PriorityQueue<K, V>& rhs) const {
 }
 
 
-template<typename K, typename V>
-bool operator<(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator<(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return lhs.operator<(rhs);
 }
 
-template<typename K, typename V>
-bool operator>(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator>(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return rhs < lhs;
 }
 
-template<typename K, typename V>
-bool operator==(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator==(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return !(lhs > rhs) && !(lhs < rhs);
 }
 
-template<typename K, typename V>
-bool operator!=(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator!=(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return !(lhs == rhs);
 }
 
-template<typename K, typename V>
-bool operator<=(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator<=(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return !(lhs > rhs);
 }
 
-template<typename K, typename V>
-bool operator>=(const PriorityQueue<K, V>& lhs, const PriorityQueue<K, V>& rhs) {
+template<typename K, typename V, typename A>
+bool operator>=(const PriorityQueue<K, V, A>& lhs, const PriorityQueue<K, V, A>& rhs) {
     return !(lhs < rhs);
 }
 
+#if __cplusplus >= 201703L
+/* PriorityQueue allocating from a std::pmr::memory_resource */
+template<typename K, typename V>
+using PmrPriorityQueue = PriorityQueue<K, V,
+    std::pmr::polymorphic_allocator<std::pair<const K, V> > >;
+#endif
+
 #endif /* PRIORITYQUEUE_HH_ */
@@ -0,0 +1,383 @@
+#ifndef STATICPRIORITYQUEUE_HH_
+#define STATICPRIORITYQUEUE_HH_
+
+#include <stddef.h>
+#include <exception>
+#if __cplusplus >= 202002L
+#include <algorithm>
+#endif
+
+#include "priorityqueue.hh"
+
+class PriorityQueueFullException : public std::exception {
+    public:
+        virtual const char* what() const throw() {
+            return "PriorityQueue full exception";
+        }
+};
+
+/* PriorityQueue of at most N pairs, kept inline in the object - it never
+ * allocates. Pairs are held in an array sorted by (value, key) from the
+ * largest to the smallest, so the minimum is the last one: minimum and
+ * maximum are O(1), deleteMin is O(1), everything that has to find or make
+ * a place in the array is O(size()), which for small N beats walking a
+ * tree. Adding pairs beyond N throws PriorityQueueFullException and leaves
+ * the queue untouched.
+ *
+ * All of it is constexpr, so with literal K and V (and C++20 for the
+ * exceptions to turn into compile errors) a queue can be built and drained
+ * at compile time. K and V have to be default constructible. */
+template<typename K, typename V, size_t N>
+class StaticPriorityQueue {
+
+    public:
+
+        typedef size_t size_type;
+        typedef K key_type;
+        typedef V value_type;
+
+        struct entry {
+            K key;
+            V val;
+        };
+
+        constexpr StaticPriorityQueue() : entries(), count(0) {
+        }
+
+        constexpr void swap(StaticPriorityQueue<K, V, N>& queue);
+        constexpr bool empty() const;
+        constexpr size_type size() const;
+        static constexpr size_type capacity() {
+            return N;
+        }
+        constexpr void insert(const K& key, const V& value);
+        constexpr const V& minValue() const;
+        constexpr const V& maxValue() const;
+        constexpr const K& minKey() const;
+        constexpr const K& maxKey() const;
+        constexpr void deleteMin();
+        constexpr void deleteMax();
+        constexpr void changeValue(const K& key, const V& value);
+        constexpr void merge(StaticPriorityQueue<K, V, N>& queue);
+        constexpr size_type eraseKey(const K& key);
+        constexpr size_type countKey(const K& key) const;
+        constexpr bool operator<(const StaticPriorityQueue<K, V, N>& other)
+            const;
+        constexpr bool operator==(const StaticPriorityQueue<K, V, N>& other)
+            const;
+
+    private:
+        static constexpr bool less(const entry& lhs, const entry& rhs) {
+            if (lhs.val < rhs.val)
+                return true;
+            else if (rhs.val < lhs.val)
+                return false;
+            return lhs.key < rhs.key;
+        }
+
+        static constexpr bool lessByKey(const entry& lhs, const entry& rhs) {
+            if (lhs.key < rhs.key)
+                return true;
+            else if (rhs.key < lhs.key)
+                return false;
+            return lhs.val < rhs.val;
+        }
+
+        constexpr size_type findKey(const K& key) const;
+        constexpr void eraseAt(size_type index);
+        constexpr void sortedByKey(size_type (&order)[N ? N : 1]) const;
+        constexpr int compare(const StaticPriorityQueue<K, V, N>& other) const;
+
+        entry entries[N ? N : 1];
+        size_type count;
+};
+
+/* COMPLEXITY - O(max(size(), queue.size())) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::swap(
+    StaticPriorityQueue<K, V, N>& queue) {
+    size_type used = count > queue.count ? count : queue.count;
+    for (size_type i = 0; i < used; ++i) {
+        entry temporary = entries[i];
+        entries[i] = queue.entries[i];
+        queue.entries[i] = temporary;
+    }
+    size_type temporary = count;
+    count = queue.count;
+    queue.count = temporary;
+}
+
+template<typename K, typename V, size_t N>
+constexpr void swap(StaticPriorityQueue<K, V, N>& lp,
+                    StaticPriorityQueue<K, V, N>& rp) {
+    lp.swap(rp);
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr bool StaticPriorityQueue<K, V, N>::empty() const {
+    return count == 0;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr typename StaticPriorityQueue<K, V, N>::size_type
+StaticPriorityQueue<K, V, N>::size() const {
+    return count;
+}
+
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::insert(const K& key,
+                                                    const V& value) {
+    if (count == N)
+        throw PriorityQueueFullException();
+    entry inserted{key, value};
+    size_type i = count;
+    while (i > 0 && less(entries[i - 1], inserted)) {
+        entries[i] = entries[i - 1];
+        --i;
+    }
+    entries[i] = inserted;
+    ++count;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr const V& StaticPriorityQueue<K, V, N>::minValue() const {
+    if (count == 0)
+        throw PriorityQueueEmptyException();
+    return entries[count - 1].val;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr const V& StaticPriorityQueue<K, V, N>::maxValue() const {
+    if (count == 0)
+        throw PriorityQueueEmptyException();
+    return entries[0].val;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr const K& StaticPriorityQueue<K, V, N>::minKey() const {
+    if (count == 0)
+        throw PriorityQueueEmptyException();
+    return entries[count - 1].key;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr const K& StaticPriorityQueue<K, V, N>::maxKey() const {
+    if (count == 0)
+        throw PriorityQueueEmptyException();
+    return entries[0].key;
+}
+
+/* COMPLEXITY - O(1) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::deleteMin() {
+    if (count > 0)
+        --count;
+}
+
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::deleteMax() {
+    if (count > 0)
+        eraseAt(0);
+}
+
+/* index of some pair with the given key, count if there is none */
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr typename StaticPriorityQueue<K, V, N>::size_type
+StaticPriorityQueue<K, V, N>::findKey(const K& key) const {
+    for (size_type i = 0; i < count; ++i) {
+        if (!(entries[i].key < key) && !(key < entries[i].key))
+            return i;
+    }
+    return count;
+}
+
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::eraseAt(size_type index) {
+    for (size_type i = index; i + 1 < count; ++i)
+        entries[i] = entries[i + 1];
+    --count;
+}
+
+/* The new place is found before anything moves, so a throwing comparison
+ * leaves the queue as it was; then the pairs in between shift by one. */
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::changeValue(const K& key,
+                                                         const V& value) {
+    size_type index = findKey(key);
+    if (index == count)
+        throw PriorityQueueNotFoundException();
+    entry changed{entries[index].key, value};
+    size_type target = index;
+    while (target > 0 && less(entries[target - 1], changed))
+        --target;
+    if (target == index) {
+        while (target + 1 < count && less(changed, entries[target + 1]))
+            ++target;
+    }
+
+    for (size_type i = index; i > target; --i)
+        entries[i] = entries[i - 1];
+    for (size_type i = index; i < target; ++i)
+        entries[i] = entries[i + 1];
+    entries[target] = changed;
+}
+
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr typename StaticPriorityQueue<K, V, N>::size_type
+StaticPriorityQueue<K, V, N>::eraseKey(const K& key) {
+    size_type kept = 0;
+    for (size_type i = 0; i < count; ++i) {
+        if (entries[i].key < key || key < entries[i].key)
+            entries[kept++] = entries[i];
+    }
+    size_type erased = count - kept;
+    count = kept;
+    return erased;
+}
+
+/* COMPLEXITY - O(size()) */
+template<typename K, typename V, size_t N>
+constexpr typename StaticPriorityQueue<K, V, N>::size_type
+StaticPriorityQueue<K, V, N>::countKey(const K& key) const {
+    size_type result = 0;
+    for (size_type i = 0; i < count; ++i) {
+        if (!(entries[i].key < key) && !(key < entries[i].key))
+            ++result;
+    }
+    return result;
+}
+
+/* throws PriorityQueueFullException, changing neither queue, if the pairs
+ * of both do not fit */
+/* COMPLEXITY - O(size() + queue.size()) */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::merge(
+    StaticPriorityQueue<K, V, N>& queue) {
+    if (this == &queue || queue.count == 0)
+        return;
+    if (count + queue.count > N)
+        throw PriorityQueueFullException();
+
+    StaticPriorityQueue<K, V, N> merged;
+    size_type i = 0, j = 0;
+    while (i < count || j < queue.count) {
+        if (j == queue.count ||
+            (i < count && !less(entries[i], queue.entries[j]))) {
+            merged.entries[merged.count++] = entries[i++];
+        } else {
+            merged.entries[merged.count++] = queue.entries[j++];
+        }
+    }
+    swap(merged);
+    queue.count = 0;
+}
+
+/* indices of the pairs in the order of (key, value); std::sort is only
+ * constexpr since C++20, before that an insertion sort has to do */
+/* COMPLEXITY - O(size() * log(size())), O(size()^2) before C++20 */
+template<typename K, typename V, size_t N>
+constexpr void StaticPriorityQueue<K, V, N>::sortedByKey(
+    size_type (&order)[N ? N : 1]) const {
+#if __cplusplus >= 202002L
+    for (size_type i = 0; i < count; ++i)
+        order[i] = i;
+    std::sort(order, order + count, [this](size_type lhs, size_type rhs) {
+        return lessByKey(entries[lhs], entries[rhs]);
+    });
+#else
+    for (size_type i = 0; i < count; ++i) {
+        size_type j = i;
+        while (j > 0 && lessByKey(entries[i], entries[order[j - 1]])) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+#endif
+}
+
+/* lexicographic, on the pairs in the order of (key, value) - just like
+ * PriorityQueue; negative, 0 or positive like strcmp */
+/* COMPLEXITY - that of sortedByKey(), on both queues */
+template<typename K, typename V, size_t N>
+constexpr int StaticPriorityQueue<K, V, N>::compare(
+    const StaticPriorityQueue<K, V, N>& rhs) const {
+    size_type order[N ? N : 1] = {};
+    size_type order_rhs[N ? N : 1] = {};
+    sortedByKey(order);
+    rhs.sortedByKey(order_rhs);
+
+    for (size_type i = 0; i < count && i < rhs.count; ++i) {
+        const entry& lhs_entry = entries[order[i]];
+        const entry& rhs_entry = rhs.entries[order_rhs[i]];
+        if (lessByKey(lhs_entry, rhs_entry))
+            return -1;
+        else if (lessByKey(rhs_entry, lhs_entry))
+            return 1;
+    }
+    return count < rhs.count ? -1 : count > rhs.count ? 1 : 0;
+}
+
+/* COMPLEXITY - that of sortedByKey(), on both queues */
+template<typename K, typename V, size_t N>
+constexpr bool StaticPriorityQueue<K, V, N>::operator<(
+    const StaticPriorityQueue<K, V, N>& rhs) const {
+    return compare(rhs) < 0;
+}
+
+/* COMPLEXITY - O(1) for different sizes, else that of sortedByKey() */
+template<typename K, typename V, size_t N>
+constexpr bool StaticPriorityQueue<K, V, N>::operator==(
+    const StaticPriorityQueue<K, V, N>& rhs) const {
+    return count == rhs.count && compare(rhs) == 0;
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator<(const StaticPriorityQueue<K, V, N>& lhs,
+                         const StaticPriorityQueue<K, V, N>& rhs) {
+    return lhs.operator<(rhs);
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator>(const StaticPriorityQueue<K, V, N>& lhs,
+                         const StaticPriorityQueue<K, V, N>& rhs) {
+    return rhs < lhs;
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator==(const StaticPriorityQueue<K, V, N>& lhs,
+                          const StaticPriorityQueue<K, V, N>& rhs) {
+    return lhs.operator==(rhs);
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator!=(const StaticPriorityQueue<K, V, N>& lhs,
+                          const StaticPriorityQueue<K, V, N>& rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator<=(const StaticPriorityQueue<K, V, N>& lhs,
+                          const StaticPriorityQueue<K, V, N>& rhs) {
+    return !(lhs > rhs);
+}
+
+template<typename K, typename V, size_t N>
+constexpr bool operator>=(const StaticPriorityQueue<K, V, N>& lhs,
+                          const StaticPriorityQueue<K, V, N>& rhs) {
+    return !(lhs < rhs);
+}
+
+#endif /* STATICPRIORITYQUEUE_HH_ */
@@ -0,0 +1,582 @@
+#ifndef TIMINGWHEELQUEUE_HH_
+#define TIMINGWHEELQUEUE_HH_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <type_traits>
+
+#include "priorityqueue.hh"
+
+/* Priority queue for timers: V is an unsigned expiry timestamp, K a timer id
+ * (it needs std::hash and ==, as well as <).
+ *
+ * Pairs live in a hierarchical timing wheel - LEVELS levels of 64 slots,
+ * level l slot s holding the timers whose timestamp differs from the wheel's
+ * current time first in the l-th group of 6 bits, and has s there. Each
+ * slot is a list, and an index from keys to list nodes makes insert,
+ * changeValue (reschedule) and eraseKey (cancel) O(1). popExpired advances
+ * the current time, handing over whole level 0 slots and moving the timers
+ * of a higher level slot one level down when the time reaches it; every
+ * timer is moved at most LEVELS times, so expiry is amortized O(1).
+ *
+ * Timers scheduled before the current time are kept in a separate list of
+ * overdue ones. Looking for the minimum moves the current time forward too:
+ * the slot holding it is cascaded down to level 0, where all timers of a
+ * slot share one timestamp, and that slot (or the overdue list) is sorted
+ * by key. A sorted slot stays sorted until a timer is added to it out of
+ * order, so draining the queue with deleteMin costs about as much as
+ * popExpired, plus O(log) per timer for sorting. None of this changes the
+ * contents, so the wheel is mutable and min* stay const. */
+template<typename K, typename V>
+class TimingWheelPriorityQueue {
+
+    static_assert(std::is_integral<V>::value && std::is_unsigned<V>::value,
+                  "TimingWheelPriorityQueue needs unsigned timestamps");
+
+    public:
+
+        typedef size_t size_type;
+        typedef K key_type;
+        typedef V value_type;
+
+        TimingWheelPriorityQueue();
+        TimingWheelPriorityQueue(const TimingWheelPriorityQueue<K, V>& queue);
+        TimingWheelPriorityQueue(TimingWheelPriorityQueue<K, V>&& queue);
+        TimingWheelPriorityQueue<K, V>& operator=(
+            TimingWheelPriorityQueue<K, V> queue);
+        void swap(TimingWheelPriorityQueue<K, V>& queue);
+
+        bool empty() const;
+        size_type size() const;
+        void insert(const K& key, const V& value);
+        const V& minValue() const;
+        const V& maxValue() const;
+        const K& minKey() const;
+        const K& maxKey() const;
+        void deleteMin();
+        void deleteMax();
+        void changeValue(const K& key, const V& value);
+        void merge(TimingWheelPriorityQueue<K, V>& queue);
+        size_type eraseKey(const K& key);
+        size_type countKey(const K& key) const;
+
+        size_type popExpired(const V& now, std::vector<std::pair<K, V> >& out);
+
+    private:
+        static const unsigned SLOT_BITS = 6;
+        static const unsigned SLOTS = 1 << SLOT_BITS;
+        static const unsigned LEVELS =
+            (sizeof(V) * 8 + SLOT_BITS - 1) / SLOT_BITS;
+        static const unsigned OVERDUE = LEVELS;
+
+        struct timer {
+            K key;
+            V val;
+            unsigned level;
+            unsigned slot;
+
+            timer(const K& k, const V& v) : key(k), val(v), level(0), slot(0) {
+            }
+        };
+
+        typedef std::list<timer> slot_type;
+        typedef typename slot_type::iterator timer_iterator;
+        typedef std::unordered_multimap<K, timer_iterator> index_type;
+
+        static unsigned group(uint64_t time, unsigned level) {
+            return (time >> (level * SLOT_BITS)) & (SLOTS - 1);
+        }
+
+        static int lowestSlot(uint64_t mask, unsigned from);
+        static int highestSlot(uint64_t mask);
+        static bool less(const timer& lhs, const timer& rhs);
+
+        slot_type& slotOf(unsigned level, unsigned slot) const;
+        void place(slot_type& from, timer_iterator it) const;
+        void unlink(timer_iterator it);
+        void take(timer_iterator it);
+        bool nextCascade(unsigned& level, int& slot, uint64_t& start) const;
+        void cascade(unsigned level, int slot, uint64_t start) const;
+        timer_iterator findMin() const;
+        const timer* findMax() const;
+        timer_iterator mutableTimer(const timer* t);
+
+        mutable uint64_t current;
+        size_type count;
+        mutable std::vector<slot_type> wheel;
+        mutable std::vector<uint64_t> occupied;
+        mutable slot_type overdue;
+        /* level 0 slots, and the overdue list, known to be in order */
+        mutable uint64_t sorted;
+        mutable bool overdueSorted;
+        index_type index;
+};
+
+/******************** Constructors ********************/
+
+template<typename K, typename V>
+TimingWheelPriorityQueue<K, V>::TimingWheelPriorityQueue()
+    : current(0), count(0), wheel(LEVELS * SLOTS), occupied(LEVELS, 0),
+      sorted(0), overdueSorted(false) {
+}
+
+/* COMPLEXITY : O(queue.size()) */
+template<typename K, typename V>
+TimingWheelPriorityQueue<K, V>::TimingWheelPriorityQueue(
+    const TimingWheelPriorityQueue<K, V>& queue)
+    : current(queue.current), count(0), wheel(LEVELS * SLOTS),
+      occupied(LEVELS, 0), sorted(0), overdueSorted(false) {
+    for (auto it = queue.index.begin(); it != queue.index.end(); ++it)
+        insert(it->second->key, it->second->val);
+}
+
+/* COMPLEXITY : O(1) - list nodes do not move, so the index stays valid */
+template<typename K, typename V>
+TimingWheelPriorityQueue<K, V>::TimingWheelPriorityQueue(
+    TimingWheelPriorityQueue<K, V>&& queue)
+    : TimingWheelPriorityQueue() {
+    swap(queue);
+}
+
+/* COMPLEXITY : O(queue.size()) for P = Q, O(1) for P = move(Q) */
+template<typename K, typename V>
+TimingWheelPriorityQueue<K, V>& TimingWheelPriorityQueue<K, V>::operator=(
+    TimingWheelPriorityQueue<K, V> queue) {
+    swap(queue);
+    return *this;
+}
+
+/* COMPLEXITY : O(1) */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::swap(
+    TimingWheelPriorityQueue<K, V>& queue) {
+    if (this != &queue) {
+        std::swap(current, queue.current);
+        std::swap(count, queue.count);
+        wheel.swap(queue.wheel);
+        occupied.swap(queue.occupied);
+        overdue.swap(queue.overdue);
+        std::swap(sorted, queue.sorted);
+        std::swap(overdueSorted, queue.overdueSorted);
+        index.swap(queue.index);
+    }
+}
+
+template<typename K, typename V>
+void swap(TimingWheelPriorityQueue<K, V>& lp,
+          TimingWheelPriorityQueue<K, V>& rp) {
+    lp.swap(rp);
+}
+
+/******************** Wheel ********************/
+
+/* first occupied slot >= from, -1 if none */
+template<typename K, typename V>
+int TimingWheelPriorityQueue<K, V>::lowestSlot(uint64_t mask, unsigned from) {
+    for (unsigned slot = from; slot < SLOTS; ++slot) {
+        if (mask & (uint64_t(1) << slot))
+            return slot;
+    }
+    return -1;
+}
+
+template<typename K, typename V>
+int TimingWheelPriorityQueue<K, V>::highestSlot(uint64_t mask) {
+    for (int slot = SLOTS - 1; slot >= 0; --slot) {
+        if (mask & (uint64_t(1) << slot))
+            return slot;
+    }
+    return -1;
+}
+
+/* the order of PriorityQueue - by value, then by key */
+template<typename K, typename V>
+bool TimingWheelPriorityQueue<K, V>::less(const timer& lhs, const timer& rhs) {
+    if (lhs.val != rhs.val)
+        return lhs.val < rhs.val;
+    return lhs.key < rhs.key;
+}
+
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::slot_type&
+TimingWheelPriorityQueue<K, V>::slotOf(unsigned level, unsigned slot) const {
+    return level == OVERDUE ? overdue : wheel[level * SLOTS + slot];
+}
+
+/* moves *it from `from` to where its value belongs relative to `current`;
+ * a level 0 slot or the overdue list stays sorted if *it goes last anyway */
+/* COMPLEXITY - O(1), no-throw as long as comparing keys does not throw */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::place(slot_type& from,
+                                           timer_iterator it) const {
+    uint64_t time = it->val;
+    unsigned level = OVERDUE;
+    unsigned slot = 0;
+    if (time >= current) {
+        level = 0;
+        for (uint64_t diff = (time ^ current) >> SLOT_BITS; diff != 0;
+             diff >>= SLOT_BITS) {
+            ++level;
+        }
+        slot = group(time, level);
+    }
+
+    slot_type& to = slotOf(level, slot);
+    bool inOrder = true;
+    if (level == 0 || level == OVERDUE) {
+        auto last = to.end();
+        if (last != to.begin() && std::prev(last) == it)
+            --last; // already the last one
+        if (last != to.begin())
+            inOrder = !less(*it, *std::prev(last));
+    }
+
+    to.splice(to.end(), from, it);
+    if (it->level != OVERDUE && &from != &to && from.empty())
+        occupied[it->level] &= ~(uint64_t(1) << it->slot);
+    it->level = level;
+    it->slot = slot;
+    if (level != OVERDUE)
+        occupied[level] |= uint64_t(1) << slot;
+
+    if (level == OVERDUE) {
+        if (to.size() == 1)
+            overdueSorted = true;
+        else if (!inOrder)
+            overdueSorted = false;
+    } else if (level == 0) {
+        if (to.size() == 1)
+            sorted |= uint64_t(1) << slot;
+        else if (!inOrder)
+            sorted &= ~(uint64_t(1) << slot);
+    }
+}
+
+/* removes the node from its slot, but not from the index */
+/* COMPLEXITY - O(1), no-throw */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::unlink(timer_iterator it) {
+    unsigned level = it->level;
+    unsigned slot = it->slot;
+    slot_type& from = slotOf(level, slot);
+    from.erase(it);
+    if (level != OVERDUE && from.empty())
+        occupied[level] &= ~(uint64_t(1) << slot);
+    --count;
+}
+
+/* removes the node from both its slot and the index */
+/* COMPLEXITY - O(number of timers with the same key), no-throw as long as
+ * hashing and comparing keys does not throw */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::take(timer_iterator it) {
+    auto range = index.equal_range(it->key);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+        if (entry->second == it) {
+            index.erase(entry);
+            break;
+        }
+    }
+    unlink(it);
+}
+
+/* The lowest occupied slot above level 0, and the time it starts at; false
+ * if there is none. Slot group(current, level) of a level is normally empty,
+ * it is only looked at so that a cascade interrupted by an exception is
+ * finished by the next one. */
+template<typename K, typename V>
+bool TimingWheelPriorityQueue<K, V>::nextCascade(unsigned& level, int& slot,
+                                                 uint64_t& start) const {
+    for (level = 1; level < LEVELS; ++level) {
+        slot = lowestSlot(occupied[level], group(current, level));
+        if (slot >= 0)
+            break;
+    }
+    if (level == LEVELS)
+        return false;
+
+    unsigned shift = (level + 1) * SLOT_BITS;
+    start = shift < 64 ? (current >> shift) << shift : 0;
+    start |= uint64_t(slot) << (level * SLOT_BITS);
+    if (start < current)
+        start = current;
+    return true;
+}
+
+/* moves the current time to `start` and everything in the slot to lower
+ * levels; only valid if nothing in the wheel is before `start` */
+/* COMPLEXITY - O(timers in the slot) */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::cascade(unsigned level, int slot,
+                                             uint64_t start) const {
+    current = start;
+    slot_type& cascading = wheel[level * SLOTS + slot];
+    while (!cascading.empty())
+        place(cascading, cascading.begin());
+}
+
+/* The minimum is in the overdue list if there is anything: those timers are
+ * all before `current`. Otherwise it is in the lowest level that has
+ * anything, since timers of level l share their upper groups with `current`
+ * while those of higher levels do not, and within a level in the lowest
+ * slot. That slot is cascaded down until it is a level 0 one, holding a
+ * single timestamp, and sorted by key if it is not yet. */
+/* COMPLEXITY - amortized O(LEVELS + log(timers with the minimum timestamp))
+ * per timer, O(1) if nothing changed since the last call */
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::timer_iterator
+TimingWheelPriorityQueue<K, V>::findMin() const {
+    auto byOrder = [](const timer& lhs, const timer& rhs) {
+        return less(lhs, rhs);
+    };
+    if (!overdue.empty()) {
+        if (!overdueSorted) {
+            overdue.sort(byOrder);
+            overdueSorted = true;
+        }
+        return overdue.begin();
+    }
+
+    while (true) {
+        int slot = lowestSlot(occupied[0], group(current, 0));
+        if (slot >= 0) {
+            if (!(sorted & (uint64_t(1) << slot))) {
+                wheel[slot].sort(byOrder);
+                sorted |= uint64_t(1) << slot;
+            }
+            return wheel[slot].begin();
+        }
+
+        unsigned level;
+        uint64_t start;
+        if (!nextCascade(level, slot, start))
+            throw PriorityQueueEmptyException();
+        cascade(level, slot, start);
+    }
+}
+
+/* symmetric - the highest slot of the highest level */
+/* COMPLEXITY - O(timers in the slot holding the maximum) */
+template<typename K, typename V>
+const typename TimingWheelPriorityQueue<K, V>::timer*
+TimingWheelPriorityQueue<K, V>::findMax() const {
+    const slot_type* candidates = nullptr;
+    for (int level = LEVELS - 1; level >= 0 && candidates == nullptr;
+         --level) {
+        int slot = highestSlot(occupied[level]);
+        if (slot >= 0)
+            candidates = &wheel[level * SLOTS + slot];
+    }
+    if (candidates == nullptr && !overdue.empty())
+        candidates = &overdue;
+    if (candidates == nullptr)
+        throw PriorityQueueEmptyException();
+
+    const timer* best = &candidates->front();
+    for (auto it = candidates->begin(); it != candidates->end(); ++it) {
+        if (less(*best, *it))
+            best = &*it;
+    }
+    return best;
+}
+
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::timer_iterator
+TimingWheelPriorityQueue<K, V>::mutableTimer(const timer* t) {
+    slot_type& slot = slotOf(t->level, t->slot);
+    for (auto it = slot.begin(); it != slot.end(); ++it) {
+        if (&*it == t)
+            return it;
+    }
+    return slot.end();
+}
+
+/******************** Operations ********************/
+
+/* COMPLEXITY : O(1) */
+template<typename K, typename V>
+bool TimingWheelPriorityQueue<K, V>::empty() const {
+    return count == 0;
+}
+
+/* COMPLEXITY : O(1) */
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::size_type
+TimingWheelPriorityQueue<K, V>::size() const {
+    return count;
+}
+
+/* COMPLEXITY : O(1) expected */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::insert(const K& key, const V& value) {
+    slot_type fresh;
+    fresh.push_back(timer(key, value));
+    fresh.front().level = OVERDUE; // i.e. not in any slot of the wheel yet
+    index.insert(std::make_pair(key, fresh.begin()));
+    place(fresh, fresh.begin());
+    ++count;
+}
+
+/* COMPLEXITY - see findMin() */
+template<typename K, typename V>
+const V& TimingWheelPriorityQueue<K, V>::minValue() const {
+    return findMin()->val;
+}
+
+/* COMPLEXITY - O(timers in the slot holding the maximum) */
+template<typename K, typename V>
+const V& TimingWheelPriorityQueue<K, V>::maxValue() const {
+    return findMax()->val;
+}
+
+/* COMPLEXITY - see findMin() */
+template<typename K, typename V>
+const K& TimingWheelPriorityQueue<K, V>::minKey() const {
+    return findMin()->key;
+}
+
+/* COMPLEXITY - O(timers in the slot holding the maximum) */
+template<typename K, typename V>
+const K& TimingWheelPriorityQueue<K, V>::maxKey() const {
+    return findMax()->key;
+}
+
+/* COMPLEXITY - see findMin(), plus O(1) expected */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::deleteMin() {
+    if (empty())
+        return;
+    take(findMin());
+}
+
+/* COMPLEXITY - O(timers in the slot holding the maximum) */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::deleteMax() {
+    if (empty())
+        return;
+    take(mutableTimer(findMax()));
+}
+
+/* reschedules one of the timers with the given key; if comparing keys
+ * throws, the timer keeps its old value where it was */
+/* COMPLEXITY - O(1) expected */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::changeValue(const K& key,
+                                                 const V& value) {
+    auto entry = index.find(key);
+    if (entry == index.end())
+        throw PriorityQueueNotFoundException();
+    timer_iterator it = entry->second;
+    V old = it->val;
+    it->val = value;
+    try {
+        place(slotOf(it->level, it->slot), it);
+    } catch (...) {
+        it->val = old; // place() throws before it moves anything
+        throw;
+    }
+}
+
+/* cancels every timer with the given key */
+/* COMPLEXITY - O(countKey(key)) expected */
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::size_type
+TimingWheelPriorityQueue<K, V>::eraseKey(const K& key) {
+    auto range = index.equal_range(key);
+    size_type erased = 0;
+    for (auto entry = range.first; entry != range.second; ++entry, ++erased)
+        unlink(entry->second);
+    index.erase(range.first, range.second);
+    return erased;
+}
+
+/* COMPLEXITY - O(countKey(key)) expected */
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::size_type
+TimingWheelPriorityQueue<K, V>::countKey(const K& key) const {
+    return index.count(key);
+}
+
+/* COMPLEXITY - O(size() + queue.size()) */
+template<typename K, typename V>
+void TimingWheelPriorityQueue<K, V>::merge(
+    TimingWheelPriorityQueue<K, V>& queue) {
+    if (this == &queue || queue.empty())
+        return;
+    TimingWheelPriorityQueue<K, V> new_one(*this);
+    for (auto it = queue.index.begin(); it != queue.index.end(); ++it)
+        new_one.insert(it->second->key, it->second->val);
+    queue = TimingWheelPriorityQueue<K, V>();
+    swap(new_one);
+}
+
+/* Appends to `out` every pair with value <= now, in order of value, and
+ * returns how many there were. Pairs are handed over a slot at a time; if
+ * copying one throws, the pairs of the slots already handed over stay in
+ * `out` and are gone from the queue, the rest of the queue is intact. */
+/* COMPLEXITY - O(popped + LEVELS * (slots passed)) amortized O(1) per pair */
+template<typename K, typename V>
+typename TimingWheelPriorityQueue<K, V>::size_type
+TimingWheelPriorityQueue<K, V>::popExpired(const V& now,
+    std::vector<std::pair<K, V> >& out) {
+    size_type popped = 0;
+    uint64_t limit = now;
+
+    auto handOver = [&](slot_type& slot, bool all) {
+        size_type before = out.size();
+        std::vector<timer_iterator> taken;
+        try {
+            for (auto it = slot.begin(); it != slot.end(); ++it) {
+                if (all || it->val <= limit) {
+                    out.push_back(std::make_pair(it->key, it->val));
+                    taken.push_back(it);
+                }
+            }
+        } catch (...) {
+            out.erase(out.begin() + before, out.end());
+            throw;
+        }
+        std::sort(out.begin() + before, out.end(),
+            [](const std::pair<K, V>& lhs, const std::pair<K, V>& rhs) {
+                return lhs.second != rhs.second ? lhs.second < rhs.second
+                                                : lhs.first < rhs.first;
+            });
+        for (auto it = taken.begin(); it != taken.end(); ++it)
+            take(*it);
+        popped += taken.size();
+    };
+
+    if (!overdue.empty())
+        handOver(overdue, false);
+    if (limit < current)
+        return popped;
+
+    while (true) {
+        int slot = lowestSlot(occupied[0], group(current, 0));
+        if (slot >= 0) {
+            uint64_t time = (current & ~uint64_t(SLOTS - 1)) | slot;
+            if (time > limit)
+                break;
+            current = time;
+            handOver(wheel[slot], true);
+            continue;
+        }
+
+        unsigned level;
+        uint64_t start;
+        if (!nextCascade(level, slot, start) || start > limit)
+            break;
+        cascade(level, slot, start);
+    }
+
+    if (empty() && current < limit)
+        current = limit;
+    return popped;
+}
+
+#endif /* TIMINGWHEELQUEUE_HH_ */